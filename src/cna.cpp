@@ -33,38 +33,56 @@ CNA::CNA(const Races::Mutations::GenomicRegion& region, const Races::Mutations::
 CNA::CNA()
 {}
 
-SEXP wrap_allele_id(const Races::Mutations::AlleleId& allele_id)
-{
-    if (allele_id == RANDOM_ALLELE) {
-        return Rcpp::wrap(NA_INTEGER);
-    }
-    return Rcpp::wrap(allele_id); 
-}
-
 SEXP CNA::get_src_allele() const
 {
     if (type == Races::Mutations::CopyNumberAlteration::Type::AMPLIFICATION) {
-        return wrap_allele_id(source);
+        return Rcpp::wrap(wrap_allele_id(source));
     }
     return Rcpp::wrap(NA_INTEGER);
 }
 
 SEXP CNA::get_allele() const
 {
-    return wrap_allele_id(dest);
+    return Rcpp::wrap(wrap_allele_id(dest));
 }
 
-Rcpp::List CNA::get_dataframe() const
+Rcpp::List get_CNA_dataframe(const std::vector<Races::Mutations::CopyNumberAlteration>& CNAs)
 {
     using namespace Rcpp;
     using namespace Races::Mutations;
 
-    return DataFrame::create(_["chromosome"]=get_chromosome(),
-                             _["pos_in_chr"]=get_position_in_chromosome(),
-                             _["length"]=get_length(),
-                             _["allele"]=get_allele(),
-                             _["src_allele"]=get_src_allele(),
-                             _["type"]=get_type());
+    CharacterVector chr_names(CNAs.size()), types(CNAs.size());
+    IntegerVector positions(CNAs.size()), lengths(CNAs.size()),
+                  alleles(CNAs.size()), src_alleles(CNAs.size());
+
+    size_t i{0};
+    for (const auto& cna : CNAs) {
+        chr_names[i] = GenomicPosition::chrtos(cna.region.get_chromosome_id());
+        positions[i] = cna.region.get_initial_position();
+        lengths[i] = cna.region.size();
+        alleles[i] = wrap_allele_id(cna.dest);
+        if (cna.type == CopyNumberAlteration::Type::AMPLIFICATION) {
+            src_alleles[i] = wrap_allele_id(cna.source);
+            types[i] = "A";
+        } else {
+            src_alleles[i] = NA_INTEGER;
+            types[i] = "D";
+        }
+
+        ++i;
+    }
+
+    return DataFrame::create(_["chromosome"]=chr_names,
+                             _["pos_in_chr"]=positions,
+                             _["length"]=lengths,
+                             _["allele"]=alleles,
+                             _["src_allele"]=src_alleles,
+                             _["type"]=types);
+}
+
+Rcpp::List CNA::get_dataframe() const
+{
+    return get_CNA_dataframe({*this});
 }
 
 void CNA::show() const
@@ -19,11 +19,36 @@
 #define __RRACES_CNA__
 
 #include <string>
+#include <vector>
 
 #include <cna.hpp>
 
 #include <Rcpp.h>
 
+/**
+ * @brief Convert an allele identifier into an R integer
+ *
+ * @param allele_id is an allele identifier
+ * @return `NA_INTEGER` if `allele_id` is `RANDOM_ALLELE`, `allele_id`
+ *      otherwise
+ */
+inline int wrap_allele_id(const Races::Mutations::AlleleId& allele_id)
+{
+    if (allele_id == RANDOM_ALLELE) {
+        return NA_INTEGER;
+    }
+
+    return static_cast<int>(allele_id);
+}
+
+/**
+ * @brief Build the data frame of a sequence of CNAs
+ *
+ * @param CNAs is a vector of CNAs
+ * @return a data frame reporting "chromosome", "pos_in_chr", "length",
+ *      "allele", "src_allele", and "type" for each CNA in `CNAs`
+ */
+Rcpp::List get_CNA_dataframe(const std::vector<Races::Mutations::CopyNumberAlteration>& CNAs);
 
 class CNA : public Races::Mutations::CopyNumberAlteration
 {
@@ -18,7 +18,10 @@
 #ifndef __RRACES_FOREST__
 #define __RRACES_FOREST__
 
+#include <map>
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 #include <Rcpp.h>
 
@@ -26,56 +29,253 @@
 
 struct ForestCore
 {
-  template<typename CPP_FOREST>
-  static Rcpp::List get_nodes(const CPP_FOREST& forest,
-                              const std::vector<Races::Mutants::CellId>& cell_ids)
+private:
+  /**
+   * @brief A builder for string columns
+   *
+   * The forest nodes share few distinct strings, i.e., the mutant
+   * names, the epistates, and the sample names. This class encodes
+   * every string by an integer code and builds the corresponding
+   * data frame column either as a factor or as a character vector
+   * whose entries share one R string per distinct value.
+   */
+  class StringColumn
+  {
+    std::map<std::string, int> codes;   //!< The 1-based code of each level
+    std::vector<std::string> levels;    //!< The column levels
+    Rcpp::IntegerVector values;         //!< The column codes
+
+  public:
+    explicit StringColumn(const size_t& size):
+      values(size, NA_INTEGER)
+    {}
+
+    inline int encode(const std::string& value)
+    {
+      auto [it, inserted] = codes.emplace(value, levels.size()+1);
+      if (inserted) {
+        levels.push_back(value);
+      }
+
+      return it->second;
+    }
+
+    inline void set_code(const size_t& index, const int& code)
+    {
+      values[index] = code;
+    }
+
+    SEXP get_column(const bool& as_factor)
+    {
+      if (as_factor) {
+        values.attr("levels") = Rcpp::wrap(levels);
+        values.attr("class") = "factor";
+
+        return values;
+      }
+
+      Rcpp::CharacterVector level_strings = Rcpp::wrap(levels);
+      Rcpp::CharacterVector strings(values.size());
+      for (R_xlen_t i=0; i<values.size(); ++i) {
+        if (values[i] == NA_INTEGER) {
+          strings[i] = NA_STRING;
+        } else {
+          strings[i] = level_strings[values[i]-1];
+        }
+      }
+
+      return strings;
+    }
+  };
+
+  /**
+   * @brief Export forest nodes in a data frame
+   *
+   * This method visits the nodes once. The mutant and epistate strings
+   * are computed once per species and all the string columns share
+   * their R strings. When `compact` is set, the string columns are
+   * factors and the column "ancestor_index" reports the 1-based row of
+   * the ancestor in the data frame.
+   *
+   * @param forest is the forest whose nodes must be exported
+   * @param cells is a range of cell identifiers or forest cell entries
+   * @param num_of_nodes is the number of elements in `cells`
+   * @param get_id extracts the cell identifier from an element of `cells`
+   * @param get_ancestor returns the ancestor identifier of a forest node
+   *        or `NA_INTEGER` if the node has no ancestor
+   * @param compact is a Boolean flag to produce the compact data frame
+   * @return a data frame representing the nodes in `cells`
+   */
+  template<typename CPP_FOREST, typename CELL_RANGE, typename GET_ID,
+           typename GET_ANCESTOR>
+  static Rcpp::List export_nodes(const CPP_FOREST& forest, const CELL_RANGE& cells,
+                                 const size_t& num_of_nodes, GET_ID get_id,
+                                 GET_ANCESTOR get_ancestor, const bool& compact)
   {
     using namespace Rcpp;
     using namespace Races::Mutants;
 
-    IntegerVector ids(cell_ids.size()), ancestors(cell_ids.size());
-    CharacterVector mutants(cell_ids.size()), epi_states(cell_ids.size()),
-                    sample_names(cell_ids.size());
-    NumericVector birth(cell_ids.size());
+    IntegerVector ids(num_of_nodes), ancestors(num_of_nodes);
+    NumericVector birth(num_of_nodes);
+    StringColumn mutants(num_of_nodes), epi_states(num_of_nodes),
+                 sample_names(num_of_nodes);
+
+    std::map<SpeciesId, std::pair<int, int>> species_codes;
 
     size_t i{0};
-    for (const auto& cell_id: cell_ids) {
+    for (const auto& cell: cells) {
+      const CellId cell_id = get_id(cell);
       ids[i] = cell_id;
-      auto cell_node = forest.get_node(cell_id);
-      if (cell_node.is_root()) {
-        ancestors[i] = NA_INTEGER;
-      } else {
-        ancestors[i] = cell_node.parent().get_id();
-      }
 
-      mutants[i] = cell_node.get_mutant_name();
-      epi_states[i] = MutantProperties::signature_to_string(cell_node.get_methylation_signature());
+      const auto cell_node = forest.get_node(cell_id);
+      ancestors[i] = get_ancestor(cell_node);
+
+      const auto& c_cell = static_cast<const Cell&>(cell_node);
+      auto found = species_codes.find(c_cell.get_species_id());
+      if (found == species_codes.end()) {
+        const auto epi_state = MutantProperties::signature_to_string(cell_node.get_methylation_signature());
+        found = species_codes.emplace(c_cell.get_species_id(),
+                                      std::make_pair(mutants.encode(cell_node.get_mutant_name()),
+                                                     epi_states.encode(epi_state))).first;
+      }
+      mutants.set_code(i, found->second.first);
+      epi_states.set_code(i, found->second.second);
 
       if (cell_node.is_leaf()) {
-        sample_names[i] = cell_node.get_sample().get_name();
-      } else {
-        sample_names[i] = NA_STRING;
+        sample_names.set_code(i, sample_names.encode(cell_node.get_sample().get_name()));
       }
-      birth[i] = static_cast<const Cell&>(cell_node).get_birth_time();
+      birth[i] = c_cell.get_birth_time();
 
       ++i;
     }
 
-    return DataFrame::create(_["cell_id"]=ids, _["ancestor"]=ancestors,
-                             _["mutant"]=mutants, _["epistate"]=epi_states,
-                             _["sample"]=sample_names, _["birth_time"]=birth);
+    List columns = List::create(_["cell_id"]=ids, _["ancestor"]=ancestors,
+                                _["mutant"]=mutants.get_column(compact),
+                                _["epistate"]=epi_states.get_column(compact),
+                                _["sample"]=sample_names.get_column(compact),
+                                _["birth_time"]=birth);
+
+    if (compact) {
+      std::unordered_map<CellId, int> rows;
+      rows.reserve(num_of_nodes);
+      for (R_xlen_t row=0; row<ids.size(); ++row) {
+        rows.emplace(ids[row], row+1);
+      }
+
+      IntegerVector ancestor_rows(num_of_nodes, NA_INTEGER);
+      for (R_xlen_t row=0; row<ancestors.size(); ++row) {
+        if (ancestors[row] != NA_INTEGER) {
+          auto found = rows.find(ancestors[row]);
+          if (found != rows.end()) {
+            ancestor_rows[row] = found->second;
+          }
+        }
+      }
+      columns.push_back(ancestor_rows, "ancestor_index");
+    }
+
+    // the data frame is built in place to avoid copying the columns
+    columns.attr("row.names") = IntegerVector::create(NA_INTEGER,
+                                                      -static_cast<int>(num_of_nodes));
+    columns.attr("class") = "data.frame";
+
+    return columns;
+  }
+
+  template<typename NODE>
+  static int get_parent_id(const NODE& cell_node)
+  {
+    if (cell_node.is_root()) {
+      return NA_INTEGER;
+    }
+
+    return cell_node.parent().get_id();
   }
 
   template<typename CPP_FOREST>
-  static Rcpp::List get_nodes(const CPP_FOREST& forest)
+  static Rcpp::List get_skeleton_nodes(const CPP_FOREST& forest, const bool& compact)
   {
-    std::vector<Races::Mutants::CellId> cell_ids;
-    cell_ids.reserve(forest.num_of_nodes());
+    using namespace Races::Mutants;
+
+    std::unordered_map<CellId, size_t> num_of_children;
+    num_of_children.reserve(forest.num_of_nodes());
     for (const auto& [cell_id, cell]: forest.get_cells()) {
-      cell_ids.push_back(cell_id);
+      const auto cell_node = forest.get_node(cell_id);
+      if (!cell_node.is_root()) {
+        ++num_of_children[cell_node.parent().get_id()];
+      }
+    }
+
+    // the skeleton contains the roots and the nodes having at least
+    // two children
+    auto in_skeleton = [&num_of_children](const auto& cell_node) {
+      if (cell_node.is_root()) {
+        return true;
+      }
+      auto found = num_of_children.find(cell_node.get_id());
+
+      return found != num_of_children.end() && found->second > 1;
+    };
+
+    std::vector<CellId> skeleton_ids;
+    std::unordered_map<CellId, int> skeleton_ancestors;
+    for (const auto& [cell_id, cell]: forest.get_cells()) {
+      const auto cell_node = forest.get_node(cell_id);
+      if (in_skeleton(cell_node)) {
+        skeleton_ids.push_back(cell_id);
+
+        // the unary chain above a skeleton node is not shared with
+        // other skeleton nodes: climbing all of them costs O(n)
+        int ancestor = NA_INTEGER;
+        if (!cell_node.is_root()) {
+          CellId ancestor_id = cell_node.parent().get_id();
+          while (!in_skeleton(forest.get_node(ancestor_id))) {
+            ancestor_id = forest.get_node(ancestor_id).parent().get_id();
+          }
+          ancestor = ancestor_id;
+        }
+        skeleton_ancestors.emplace(cell_id, ancestor);
+      }
+    }
+
+    return export_nodes(forest, skeleton_ids, skeleton_ids.size(),
+                        [](const CellId& cell_id) { return cell_id; },
+                        [&skeleton_ancestors](const auto& cell_node) {
+                          return skeleton_ancestors.at(cell_node.get_id());
+                        }, compact);
+  }
+
+public:
+  template<typename CPP_FOREST>
+  static Rcpp::List get_nodes(const CPP_FOREST& forest,
+                              const std::vector<Races::Mutants::CellId>& cell_ids)
+  {
+    using namespace Races::Mutants;
+
+    return export_nodes(forest, cell_ids, cell_ids.size(),
+                        [](const CellId& cell_id) { return cell_id; },
+                        [](const auto& cell_node) { return get_parent_id(cell_node); },
+                        false);
+  }
+
+  template<typename CPP_FOREST>
+  static Rcpp::List get_nodes(const CPP_FOREST& forest, const bool& compact,
+                              const bool& skeleton)
+  {
+    if (skeleton) {
+      return get_skeleton_nodes(forest, compact);
     }
 
-    return ForestCore::get_nodes<CPP_FOREST>(forest, cell_ids);
+    return export_nodes(forest, forest.get_cells(), forest.num_of_nodes(),
+                        [](const auto& cell_entry) { return cell_entry.first; },
+                        [](const auto& cell_node) { return get_parent_id(cell_node); },
+                        compact);
+  }
+
+  template<typename CPP_FOREST>
+  inline static Rcpp::List get_nodes(const CPP_FOREST& forest)
+  {
+    return ForestCore::get_nodes<CPP_FOREST>(forest, false, false);
   }
 
   template<typename CPP_FOREST>
@@ -15,9 +15,17 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <tuple>
+#include <limits>
+#include <vector>
 #include <fstream>
+#include <algorithm>
 #include <filesystem>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #include <Rcpp.h>
 
 
@@ -28,6 +36,7 @@
 #include <progress_bar.hpp>
 
 #include "genomic_data_storage.hpp"
+#include "parallel_tasks.hpp"
 
 
 GermlineSubject::GermlineSubject(const std::string& name, const std::string& population,
@@ -179,26 +188,90 @@ Rcpp::List GermlineStorage::get_subject_df(const std::string& subject_name) cons
 }
 
 Races::Mutations::GenomeMutations
-GermlineStorage::build_germline(const std::string& subject_name) const
+GermlineStorage::build_germline(const GermlineSubject& subject) const
 {
   using namespace Races::Mutations;
 
-  auto bin_path = get_binary_file(subject_name);
-
-  auto subject = get_subject(subject_name);
+  auto bin_path = get_binary_file(subject.name);
 
   auto num_of_alleles = get_alleles_per_chromosome(subject.gender);
 
   auto germline = GermlineMutations::load(get_file(), num_of_alleles,
                                           subject.name);
 
-  Races::Archive::Binary::Out oarchive(bin_path);
+  // the binary file is saved under a temporary name and then renamed
+  // so that no partially written file is ever read
+  auto tmp_path = bin_path;
+  tmp_path += ".tmp_" + get_unique_suffix();
+  try {
+    Races::Archive::Binary::Out oarchive(tmp_path);
 
-  oarchive.save(germline, "germline");
+    oarchive.save(germline, "germline");
+  } catch (...) {
+    std::error_code error;
+    std::filesystem::remove(tmp_path, error);
+
+    throw;
+  }
+
+  std::filesystem::rename(tmp_path, bin_path);
 
   return germline;
 }
 
+/**
+ * @brief Get the size of the physical memory
+ *
+ * @return the size of the physical memory in bytes, if it is
+ *      available, or the maximum `size_t` value, otherwise
+ */
+size_t get_physical_memory()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+  const long num_of_pages = sysconf(_SC_PHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGE_SIZE);
+
+  if (num_of_pages > 0 && page_size > 0) {
+    return static_cast<size_t>(num_of_pages)*static_cast<size_t>(page_size);
+  }
+#endif
+
+  return std::numeric_limits<size_t>::max();
+}
+
+size_t GermlineStorage::precompile_germlines(const size_t& num_threads) const
+{
+  std::vector<GermlineSubject> missing_subjects;
+  for (const auto& subject : get_population()) {
+    if (!std::filesystem::exists(get_binary_file(subject.name))) {
+      missing_subjects.push_back(subject);
+    }
+  }
+
+  if (missing_subjects.size()==0) {
+    return 0;
+  }
+
+  // every task loads one germline: the first one is built alone and
+  // the size of its binary file estimates the memory of each task
+  build_germline(missing_subjects[0]);
+
+  // the in-memory germline is larger than its binary file
+  const size_t memory_per_task = 4*std::max(std::filesystem::file_size(get_binary_file(missing_subjects[0].name)),
+                                            static_cast<std::uintmax_t>(1));
+
+  // the tasks can use at most half of the physical memory
+  const size_t num_workers = std::min(num_threads,
+                                      std::max(get_physical_memory()/2/memory_per_task,
+                                               static_cast<size_t>(1)));
+
+  run_in_parallel(missing_subjects.size()-1, num_workers, [&](const size_t i) {
+    build_germline(missing_subjects[i+1]);
+  });
+
+  return missing_subjects.size();
+}
+
 Races::Mutations::GenomeMutations
 GermlineStorage::get_germline(const std::string& subject_name) const
 {
@@ -244,6 +317,8 @@ GenomicDataStorage::GenomicDataStorage(const std::string& directory,
 {
   std::filesystem::create_directory(directory);
 
+  prefetch_sources();
+
   retrieve_reference();
   retrieve_SBS();
   retrieve_drivers();
@@ -273,7 +348,7 @@ std::string GenomicDataStorage::get_destination_path(const std::string& url) con
   }
 }
 
-std::filesystem::path GenomicDataStorage::download_file(const std::string& url) const
+void GenomicDataStorage::download_files(const std::vector<std::string>& urls) const
 {
   if (!std::filesystem::exists(directory)) {
     std::filesystem::create_directory(directory);
@@ -281,24 +356,120 @@ std::filesystem::path GenomicDataStorage::download_file(const std::string& url)
 
   using namespace Rcpp;
 
-  std::string dest_filename = get_destination_path(url);
+  // files are downloaded into ".part" files and renamed once 
+  // completed. Hence, an interrupted download is never mistaken for 
+  // a complete one
+  std::vector<std::string> missing_urls, dest_filenames, part_filenames;
+  for (const auto& url : urls) {
+    const auto dest_filename = get_destination_path(url);
+
+    if (!std::filesystem::exists(dest_filename)) {
+      missing_urls.push_back(url);
+      dest_filenames.push_back(dest_filename);
+      part_filenames.push_back(dest_filename + ".part");
+    }
+  }
+
+  if (missing_urls.size()==0) {
+    return;
+  }
 
-  // get default timeout option
+  // get default timeout and warning options
   Function getOption_f("getOption");
   auto timeout = as<int>(getOption_f("timeout"));
+  auto warn = as<int>(getOption_f("warn"));
 
-  // raise the timeout to 1000 at least
+  // raise the timeout to 1000 at least and turn the download warnings,
+  // e.g., HTTP errors, into errors
   Function options_f("options");
-  options_f(_["timeout"] = std::max(1000, timeout));
+  options_f(_["timeout"] = std::max(1000, timeout), _["warn"] = 2);
+
+  auto remove_part_files = [&part_filenames]() {
+    for (const auto& part_filename : part_filenames) {
+      std::error_code error;
+      std::filesystem::remove(part_filename, error);
+    }
+  };
 
-  // download the file
+  // download the files: the "libcurl" method fetches them concurrently
   Function download_f("download.file");
-  download_f(_["url"] = url, _["destfile"] = dest_filename);
+  IntegerVector status;
+  try {
+    if (missing_urls.size()==1) {
+      status = download_f(_["url"] = missing_urls[0], _["destfile"] = part_filenames[0],
+                          _["mode"] = "wb");
+    } else {
+      status = download_f(_["url"] = wrap(missing_urls), _["destfile"] = wrap(part_filenames),
+                          _["method"] = "libcurl", _["mode"] = "wb");
+    }
+  } catch (std::exception& exception) {
+    options_f(_["timeout"] = timeout, _["warn"] = warn);
+    remove_part_files();
+
+    throw std::runtime_error("Downloading the files failed: " + std::string(exception.what()));
+  } catch (...) {
+    options_f(_["timeout"] = timeout, _["warn"] = warn);
+    remove_part_files();
+
+    throw;
+  }
+
+  // revert to the default options
+  options_f(_["timeout"] = timeout, _["warn"] = warn);
+
+  for (size_t i=0; i<missing_urls.size(); ++i) {
+    // download.file() returns either one status per URL or a single status
+    const size_t status_size = static_cast<size_t>(status.size());
+    const int url_status = (status_size==missing_urls.size()? status[i]:
+                            (status_size>0? status[0]: 0));
+    if (url_status != 0 || !std::filesystem::exists(part_filenames[i])) {
+      remove_part_files();
+
+      throw std::runtime_error("Downloading \"" + missing_urls[i] + "\" failed.");
+    }
+  }
+
+  for (size_t i=0; i<missing_urls.size(); ++i) {
+    std::filesystem::rename(part_filenames[i], dest_filenames[i]);
+  }
+}
+
+std::filesystem::path GenomicDataStorage::download_file(const std::string& url) const
+{
+  download_files({url});
+
+  return get_destination_path(url);
+}
 
-  // revert to the default timeout
-  options_f(_["timeout"] = timeout);
+void GenomicDataStorage::prefetch_sources()
+{
+  reference_downloaded = is_an_URL(reference_src);
+  SBS_downloaded = is_an_URL(SBS_src);
+  drivers_downloaded = is_an_URL(drivers_src);
+  passenger_CNAs_downloaded = is_an_URL(passenger_CNAs_src);
+  germline_downloaded = is_an_URL(germline_src);
 
-  return dest_filename;
+  std::vector<std::string> urls;
+
+  for (const auto& [downloaded, url, path] : {
+          std::make_tuple(reference_downloaded, reference_src, get_reference_path()),
+          std::make_tuple(SBS_downloaded, SBS_src, get_SBS_path()),
+          std::make_tuple(drivers_downloaded, drivers_src, get_driver_mutations_path()),
+          std::make_tuple(passenger_CNAs_downloaded, passenger_CNAs_src, get_passenger_CNAs_path()),
+          std::make_tuple(germline_downloaded, germline_src, directory/"germline_data")
+       }) {
+    if (downloaded && !std::filesystem::exists(path)) {
+      urls.push_back(url);
+    }
+  }
+
+  if (urls.size()>1) {
+    Rcpp::Rcout << "Downloading " << urls.size() << " files..." << std::endl << std::flush;
+
+    download_files(urls);
+
+    Rcpp::Rcout << "Files downloaded" << std::endl;
+  }
 }
 
 std::map<std::string, std::string> decompressors{
@@ -330,7 +501,7 @@ std::filesystem::path GenomicDataStorage::retrieve_reference()
 
   auto suffix = downloaded_file.substr(downloaded_file.find_last_of('.')+1);
 
-  if (suffix == "fa" && suffix == "fasta") {
+  if (suffix == "fa" || suffix == "fasta") {
     std::filesystem::rename(downloaded_file, reference_filename);
   } else {
     Rcout << "Decompressing reference file...";
@@ -343,8 +514,16 @@ std::filesystem::path GenomicDataStorage::retrieve_reference()
     Environment pkg = Environment::namespace_env("R.utils");
     Function decompress_f = pkg[decomp_found->second];
 
+    // decompress into a temporary file to never leave a truncated
+    // reference if the decompression is interrupted
+    auto tmp_filename = reference_filename;
+    tmp_filename += ".part";
+
     decompress_f(_["filename"] = downloaded_file, 
-                 _["destname"] = std::string(reference_filename));
+                 _["destname"] = std::string(tmp_filename),
+                 _["overwrite"] = true);
+
+    std::filesystem::rename(tmp_filename, reference_filename);
 
     Rcout << "done" << std::endl;
   }
@@ -465,8 +644,16 @@ std::filesystem::path GenomicDataStorage::retrieve_germline()
 
   Function untar("untar");
 
+  // extract into a temporary directory to never leave a partial 
+  // germline directory if the extraction is interrupted
+  const auto tmp_path = directory/".germline_tmp";
+  std::filesystem::remove_all(tmp_path);
+
   untar(_["tarfile"] = downloaded_file, 
-        _["exdir"] = std::string(directory));
+        _["exdir"] = std::string(tmp_path));
+
+  std::filesystem::rename(tmp_path/"germline_data", germline_path);
+  std::filesystem::remove_all(tmp_path);
 
   return germline_path;
 }
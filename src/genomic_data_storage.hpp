@@ -64,7 +64,12 @@ class GermlineStorage
     return get_path()/("germline_" + subject_name + ".dat");
   }
 
-  Races::Mutations::GenomeMutations build_germline(const std::string& subject_name) const;
+  Races::Mutations::GenomeMutations build_germline(const GermlineSubject& subject) const;
+
+  inline Races::Mutations::GenomeMutations build_germline(const std::string& subject_name) const
+  {
+    return build_germline(get_subject(subject_name));
+  }
 
 public:
 
@@ -86,6 +91,20 @@ public:
 
   Races::Mutations::GenomeMutations get_germline(const std::string& subject_name) const;
 
+  /**
+   * @brief Build the binary germline files of all the subjects
+   *
+   * The binary files of the subjects are independently built in 
+   * parallel. Already existing binary files are not re-built.
+   * Since every task holds one germline in memory, the number of
+   * concurrent tasks is reduced when their estimated memory exceeds
+   * half of the physical memory.
+   *
+   * @param num_threads is the number of threads
+   * @return the number of built files
+   */
+  size_t precompile_germlines(const size_t& num_threads) const;
+
   Rcpp::List get_subject_df(const std::string& subject_name) const;
   
   Rcpp::List get_population_df() const;
@@ -115,8 +134,12 @@ class GenomicDataStorage
 
   std::string get_destination_path(const std::string& url) const;
 
+  void download_files(const std::vector<std::string>& urls) const;
+
   std::filesystem::path download_file(const std::string& url) const;
 
+  void prefetch_sources();
+
   std::filesystem::path retrieve_reference();
 
   std::filesystem::path retrieve_SBS();
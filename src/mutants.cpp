@@ -103,11 +103,21 @@ RCPP_MODULE(Mutants){
 //' }
 //' @field death_activation_level The number of cells that activates cell death in a species.
 //' @field duplicate_internal_cells Enable/disable duplication for internal cells.
+//' @field fork Creates an independent copy of the simulation \itemize{
+//' \item \emph{Returns:} A temporary simulation having the same state of the
+//'         current one.
+//' }
 //' @field get_added_cells Gets the cells manually added to the simulation \itemize{
 //' \item \emph{Returns:} A data frame reporting "mutant", "epistate", "position_x",
 //'         "position_y", and "time" for each cells manually added to
 //'         the simulation.
 //' }
+//' @field search_densest_sample Seach the rectangular sample having the most cells of a mutant\itemize{
+//' \item \emph{Parameter:} \code{mutant_name} - The mutant of the searched cells.
+//' \item \emph{Parameter:} \code{width} - The width of the searched sample.
+//' \item \emph{Parameter:} \code{height} - The height of the searched sample.
+//' \item \emph{Returns:} The rectangle containing the most cells of the mutant.
+//' }
 //' @field search_sample Seach a rectangular sample having a minimum number of cells\itemize{
 //' \item \emph{Parameter:} \code{mutant_name} - The mutant of the searched cells.
 //' \item \emph{Parameter:} \code{num_of_cells} - The number of cells in the searched sample.
@@ -142,6 +152,9 @@ RCPP_MODULE(Mutants){
 //' \item \emph{Returns:} A data frame reporting "mutant", "epistate", "counts" for each
 //'      species in the simulation.
 //' }
+//' @field get_disk_usage Gets the disk space used by the simulation \itemize{
+//' \item \emph{Returns:} The number of bytes stored in the simulation directory.
+//' }
 //' @field get_firing_history Gets the history of the number of fired events \itemize{
 //' \item \emph{Returns:} A data frame reporting "event", "mutant", "epistate", "fired",
 //'      and "time" for each event type, for each species, and for each sampled time.
@@ -158,11 +171,25 @@ RCPP_MODULE(Mutants){
 //' \item \emph{Returns:} A data frame reporting "ancestor", "progeny", and "first_occurrence"
 //'         of each species-to-species transition.
 //' }
+//' @field get_new_count_history Gets the cell counts sampled after the last call \itemize{
+//' \item \emph{Returns:} A data frame reporting the factors "mutant" and "epistate",
+//'     "count", and "time" for each non-null count sampled after the last call.
+//' }
+//' @field get_new_firing_history Gets the event firings sampled after the last call \itemize{
+//' \item \emph{Returns:} A data frame reporting the factors "event", "mutant", and
+//'     "epistate", "fired", and "time" for each non-null firing sampled after
+//'     the last call.
+//' }
+//' @field get_profile Gets the profiling report \itemize{
+//' \item \emph{Returns:} A data frame reporting "name", "type", "calls", "value",
+//'     and "rate" for each timer and counter.
+//' }
 //' @field get_rates Gets the rates of a species\itemize{
 //' \item \emph{Parameter:} \code{species} - The species whose rates are aimed.
 //' \item \emph{Returns:} The list of the species names.
 //' }
 //' @field get_samples_forest Get the samples forest\itemize{
+//' \item \emph{Parameter:} \code{sample_names} - The names of the samples to be considered (optional).
 //' \item \emph{Returns:} The descendants forest having as leaves the sampled cells.
 //' }
 //' @field get_samples_info Retrieve information about the samples \itemize{
@@ -202,6 +229,10 @@ RCPP_MODULE(Mutants){
 //' \item \emph{Parameter:} \code{dest} - The name of the mutant to which the mutation leads.
 //' \item \emph{Parameter:} \code{time} - The simulated time at which the mutation will occurs.
 //' }
+//' @field reset_history_cursors Resets the cursors of the incremental history exports \itemize{
+//' \item \emph{Returns:} Nothing. The next calls of `get_new_count_history()` and 
+//'     `get_new_firing_history()` will report the whole history.
+//' }
 //' @field run_up_to_event Simulates cell evolution \itemize{
 //' \item \emph{Parameter:} \code{event} - The considered event type, i.e., "growth", "death", or "switch".
 //' \item \emph{Parameter:} \code{species} - The species whose event number is considered.
@@ -211,9 +242,31 @@ RCPP_MODULE(Mutants){
 //' \item \emph{Parameter:} \code{species} - The species whose number of cells is considered.
 //' \item \emph{Parameter:} \code{num_of_cells} - The threshold for the cell number.
 //' }
+//' @field run_up_to_size_async Simulates cell evolution in background \itemize{
+//' \item \emph{Parameter:} \code{species} - The species whose number of cells is considered.
+//' \item \emph{Parameter:} \code{num_of_cells} - The threshold for the cell number.
+//' }
 //' @field run_up_to_time Simulates cell evolution \itemize{
 //' \item \emph{Parameter:} \code{time} - The final simulation time.
 //' }
+//' @field run_up_to_time_async Simulates cell evolution in background \itemize{
+//' \item \emph{Parameter:} \code{time} - The final simulation time.
+//' }
+//' @field get_run_status Gets the status of the background simulation \itemize{
+//' \item \emph{Returns:} A list reporting whether the simulation is "running"
+//'      and its "clock".
+//' }
+//' @field wait Waits for the background simulation to end
+//' @field stop Stops the background simulation
+//' @field set_profiling Enables/disables profiling \itemize{
+//' \item \emph{Parameter:} \code{enabled} - A Boolean flag to enable profiling.
+//' }
+//' @field set_step_callback Sets a function periodically called during the simulation \itemize{
+//' \item \emph{Parameter:} \code{callback} - A function taking as parameter the species counts.
+//' \item \emph{Parameter:} \code{num_of_events} - The number of events between two calls.
+//' \item \emph{Parameter:} \code{time_delta} - The simulated time between two calls.
+//' }
+//' @field clear_step_callback Removes the step callback
 //' @field sample_cells Sample a tissue rectangle region \itemize{
 //' \item \emph{Parameter:} \code{name} - The sample name.
 //' \item \emph{Parameter:} \code{lower_corner} - The bottom-left corner of the rectangle.
@@ -420,6 +473,11 @@ RCPP_MODULE(Mutants){
 
 //' @name Simulation$get_samples_forest
 //' @title Get the samples forest
+//' @description The forest is built from the simulation log once per set
+//'      of samples and subsequent calls reuse it until new samples are
+//'      collected.
+//' @param sample_names The names of the samples whose cells are the leaves
+//'      of the forest (optional).
 //' @return The samples forest having as leaves the sampled cells
 //' @examples
 //' sim <- new(Simulation)
@@ -438,8 +496,48 @@ RCPP_MODULE(Mutants){
 //' forest <- sim$get_samples_forest()
 //'
 //' forest
-  .method("get_samples_forest", &Simulation::get_samples_forest,
+//'
+//' # sample the region [500,550]x[475,550] and build the forest of "S2" alone
+//' sim$sample_cells("S2", lower_corner=c(500,475), upper_corner=c(550,550))
+//' sim$get_samples_forest("S2")
+  .method("get_samples_forest", (SamplesForest (Simulation::*)() const)(&Simulation::get_samples_forest),
           "Get the descendants forest having as leaves the sampled cells")
+  .method("get_samples_forest",
+          (SamplesForest (Simulation::*)(const std::vector<std::string>&) const)(&Simulation::get_samples_forest),
+          "Get the descendants forest having as leaves the cells in some samples")
+
+//' @name Simulation$fork
+//' @title Creates an independent copy of the simulation
+//' @description This method creates a new simulation having the same
+//'      tissue, species, rates, scheduled mutations, and history of the
+//'      current one. The two simulations evolve independently and can be
+//'      modified, e.g., by `update_rates()`, without affecting each other.
+//'      The fork also inherits the name, the step callback, and a copy
+//'      of the profiling data of the current simulation.
+//'      The simulation state is copied in memory, while the fork logs
+//'      into a temporary copy of the current simulation log, which is
+//'      deleted together with the fork; hence, the samples forest of the
+//'      fork also includes the pre-fork lineage. Since the whole log is
+//'      copied, both the time and the disk space required by this method
+//'      grow with the length of the simulated history.
+//' @return A temporary simulation having the same state of the current one.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time(30)
+//'
+//' # branch the simulation and treat the branch
+//' treated <- sim$fork()
+//' treated$update_rates("A", c(death = 0.3))
+//'
+//' sim$run_up_to_time(40)
+//' treated$run_up_to_time(40)
+//'
+//' sim$get_counts()
+//' treated$get_counts()
+  .method("fork", &Simulation::fork,
+          "Create an independent copy of the simulation")
 
 //' @name Simulation$death_activation_level
 //' @title The number of cells that activates cell death in a species.
@@ -539,6 +637,13 @@ RCPP_MODULE(Mutants){
 //' @param upper_corner The upper-right corner of the selection frame (optional).
 //' @param mutant_filter The vector of the to-be-selected mutant names (optional).
 //' @param epigenetic_filter The vector of the to-be-selected epigenetic states (optional).
+//' @param stride The sampling step along the two axes: only the positions
+//'    whose distances from `lower_corner` on both the axes are multiples
+//'    of `stride` are inspected (optional: default value is 1). This 
+//'    parameter requires all the four previous parameters.
+//' @param as_factors A Boolean flag to get the "mutant" and "epistate" 
+//'    columns as factors (optional: default value is FALSE). This 
+//'    parameter requires all the five previous parameters.
 //' @return A data frame reporting "cell_id", "mutant", "epistate", "position_x",
 //'    and "position_y" for each cells satisfying the provided filters and laying
 //'    in the input frame.
@@ -571,6 +676,17 @@ RCPP_MODULE(Mutants){
 //' # cells can be filtered by frame, mutant, and epigenetic states
 //' sim$get_cells(lower_corner=c(495,495), upper_corner=c(505,505),
 //'               mutant_filter=c("A"),epigenetic_filter=c("+","-"))
+//'
+//' # a downsampled snapshot having factor columns
+//' sim$get_cells(lower_corner=c(0,0), upper_corner=c(999,999),
+//'               mutant_filter=c("A","B"),epigenetic_filter=c("+","-"),
+//'               stride=4, as_factors=TRUE)
+  .method("get_cells", (List (Simulation::*)(const std::vector<RE::AxisPosition>&,
+                                             const std::vector<RE::AxisPosition>&,
+                                             const std::vector<std::string>&,
+                                             const std::vector<std::string>&,
+                                             const size_t&, const bool&) const)(&Simulation::get_cells),
+          "Get cells from the simulated tissue")
   .method("get_cells", (List (Simulation::*)(const std::vector<RE::AxisPosition>&,
                                              const std::vector<RE::AxisPosition>&,
                                              const std::vector<std::string>&,
@@ -592,6 +708,58 @@ RCPP_MODULE(Mutants){
 //' sim$get_name()
   .method("get_name", &Simulation::get_name, "Get the simulation name")
 
+//' @name Simulation$get_disk_usage
+//' @title Gets the disk space used by the simulation
+//' @description The simulation directory contains the cell-event log and,
+//'         when `save_snapshots` is set, the simulation snapshots. Its size
+//'         grows with the number of simulated events and it can be used to
+//'         decide when to stop the simulation or to move it to a larger
+//'         storage.
+//' @return The number of bytes stored in the simulation directory.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time(30)
+//'
+//' sim$get_disk_usage()
+  .method("get_disk_usage", &Simulation::get_disk_usage,
+          "Get the disk space used by the simulation")
+
+//' @name Simulation$set_profiling
+//' @title Enables/disables profiling
+//' @description When profiling is enabled, the simulation measures the
+//'         time spent in evolving the tissue, collecting cells, and
+//'         building the samples forest, and it counts the iterations of
+//'         the evolution loop (usually, one per fired event), the
+//'         simulated time, and the growth of the simulation directory
+//'         disk usage during the evolution. Disabling profiling discards
+//'         the collected data.
+//' @param enabled A Boolean flag to enable profiling.
+//' @seealso `Simulation$get_profile()` for usage examples
+  .method("set_profiling", &Simulation::set_profiling,
+          "Enable/disable profiling")
+
+//' @name Simulation$get_profile
+//' @title Gets the profiling report
+//' @description This method reports the timers and the counters collected
+//'         since profiling has been enabled. The rate of a counter is its
+//'         value per second of the associated timer, e.g., the evolution
+//'         loop iterations per second of evolution.
+//' @return A data frame reporting "name", "type" (either "timer" or
+//'         "counter"), "calls", "value" (the total seconds for timers),
+//'         and "rate" for each timer and counter.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$set_profiling(TRUE)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time(30)
+//'
+//' sim$get_profile()
+  .method("get_profile", &Simulation::get_profile,
+          "Get the profiling report")
+
 //' @name Simulation$get_lineage_graph
 //' @title Gets the simulation lineage graph
 //' @description At the beginning of the computation only the species of the added
@@ -742,6 +910,81 @@ RCPP_MODULE(Mutants){
   .method("get_firing_history", (List (Simulation::*)() const)&Simulation::get_firing_history,
           "Get the number of simulated events per species along the computation")
 
+//' @name Simulation$get_new_count_history
+//' @title Gets the cell counts sampled after the last call
+//' @description This method incrementally exports the history of the 
+//'           number of species cells: it returns the history samples 
+//'           whose time follows the one of the last sample returned by 
+//'           the previous call. Null counts are omitted.
+//' @return A data frame reporting the factors "mutant" and "epistate", 
+//'     "count", and "time" for each species having cells at a newly 
+//'     sampled time.
+//' @seealso `Simulation$reset_history_cursors()` to restart the 
+//'     export from the beginning of the history.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$history_delta <- 20
+//' sim$run_up_to_time(50)
+//'
+//' # get the history up to time 50
+//' sim$get_new_count_history()
+//'
+//' sim$run_up_to_time(70)
+//'
+//' # get the history samples after time 50
+//' sim$get_new_count_history()
+  .method("get_new_count_history", &Simulation::get_new_count_history,
+          "Get the number of cells per species sampled after the last call")
+
+//' @name Simulation$get_new_firing_history
+//' @title Gets the event firings sampled after the last call
+//' @description This method incrementally exports the history of the 
+//'           fired events: it returns the history samples whose time
+//'           follows the one of the last sample returned by the 
+//'           previous call. Null firings are omitted.
+//' @return A data frame reporting the factors "event", "mutant", and 
+//'     "epistate", "fired", and "time" for each event type and species
+//'     having fired at a newly sampled time.
+//' @seealso `Simulation$reset_history_cursors()` to restart the 
+//'     export from the beginning of the history.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$history_delta <- 20
+//' sim$run_up_to_time(50)
+//'
+//' # get the history up to time 50
+//' sim$get_new_firing_history()
+//'
+//' sim$run_up_to_time(70)
+//'
+//' # get the history samples after time 50
+//' sim$get_new_firing_history()
+  .method("get_new_firing_history", &Simulation::get_new_firing_history,
+          "Get the number of fired events per species sampled after the last call")
+
+//' @name Simulation$reset_history_cursors
+//' @title Resets the cursors of the incremental history exports
+//' @description After this call, `get_new_count_history()` and
+//'           `get_new_firing_history()` report the whole history.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$history_delta <- 20
+//' sim$run_up_to_time(50)
+//'
+//' sim$get_new_count_history()
+//'
+//' # export again the whole history
+//' sim$reset_history_cursors()
+//' sim$get_new_count_history()
+  .method("reset_history_cursors", &Simulation::reset_history_cursors,
+          "Reset the cursors of the incremental history exports")
+
 //' @name Simulation$get_rates
 //' @title Get the rates of a species
 //' @param species The species whose rates are aimed.
@@ -899,6 +1142,155 @@ RCPP_MODULE(Mutants){
   .method("run_up_to_size", &Simulation::run_up_to_size,
           "Simulate the system up to the specified number of cells in the species")
 
+//' @name Simulation$run_up_to_time_async
+//' @title Simulates cell evolution in background
+//' @description This method starts the simulation of the cell evolution 
+//'      in a background thread and it immediately returns. While the 
+//'      simulation is running, only the methods `get_run_status()`, 
+//'      `wait()`, and `stop()` can be called on the simulation object:
+//'      any other method raises an error. Background simulations do
+//'      not support step callbacks: this method raises an error when
+//'      a step callback has been set. An error raised by a previous
+//'      background simulation, and not yet reported by `wait()`, is
+//'      raised before starting the new one.
+//' @param time The final simulation time.
+//' @seealso `Simulation$get_run_status()`, `Simulation$wait()`, and 
+//'      `Simulation$stop()` to handle the background simulation.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//'
+//' # simulate the tissue up to simulate timed 40 in background
+//' sim$run_up_to_time_async(40)
+//'
+//' # check the simulation status
+//' sim$get_run_status()
+//'
+//' # wait for the end of the simulation
+//' sim$wait()
+  .method("run_up_to_time_async", &Simulation::run_up_to_time_async,
+          "Simulate in background the system up to the specified simulation time")
+
+//' @name Simulation$run_up_to_size_async
+//' @title Simulates cell evolution in background
+//' @description This method starts the simulation of the cell evolution 
+//'      in a background thread and it immediately returns. While the 
+//'      simulation is running, only the methods `get_run_status()`, 
+//'      `wait()`, and `stop()` can be called on the simulation object:
+//'      any other method raises an error. Background simulations do
+//'      not support step callbacks: this method raises an error when
+//'      a step callback has been set. An error raised by a previous
+//'      background simulation, and not yet reported by `wait()`, is
+//'      raised before starting the new one.
+//' @param species The species whose number of cells is considered.
+//' @param num_of_cells The threshold for the cell number.
+//' @seealso `Simulation$get_run_status()`, `Simulation$wait()`, and 
+//'      `Simulation$stop()` to handle the background simulation.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//'
+//' # simulate the tissue until the species A reaches 1000 cells
+//' sim$run_up_to_size_async("A", 1000)
+//'
+//' # stop the simulation
+//' sim$stop()
+//'
+//' sim$get_clock()
+  .method("run_up_to_size_async", &Simulation::run_up_to_size_async,
+          "Simulate in background the system up to the specified number of cells in the species")
+
+//' @name Simulation$get_run_status
+//' @title Gets the status of the background simulation
+//' @return A list whose field "running" is TRUE if and only if the 
+//'      simulation is running in background and whose field "clock"
+//'      reports the last observed simulated time.
+//' @seealso `Simulation$run_up_to_time_async()` and 
+//'      `Simulation$run_up_to_size_async()` to start a background 
+//'      simulation.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time_async(40)
+//'
+//' sim$get_run_status()
+//'
+//' sim$wait()
+  .method("get_run_status", &Simulation::get_run_status,
+          "Get the status of the background simulation")
+
+//' @name Simulation$wait
+//' @title Waits for the background simulation to end
+//' @description This method blocks the R session until the background 
+//'      simulation ends. Interrupting the wait does not stop the 
+//'      simulation.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time_async(40)
+//'
+//' sim$wait()
+  .method("wait", &Simulation::wait,
+          "Wait for the background simulation to end")
+
+//' @name Simulation$stop
+//' @title Stops the background simulation
+//' @description This method stops the background simulation and waits 
+//'      for its termination.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_time_async(500)
+//'
+//' sim$stop()
+  .method("stop", &Simulation::stop,
+          "Stop the background simulation")
+
+//' @name Simulation$set_step_callback
+//' @title Sets a function periodically called during the simulation
+//' @description This method sets a function that is called by
+//'      `run_up_to_time()`, `run_up_to_size()`, and `run_up_to_event()`
+//'      every `num_of_events` simulated events and every `time_delta` 
+//'      simulated time. The function receives the data frame 
+//'      produced by `get_counts()` and, if it returns TRUE, the 
+//'      simulation stops. Background simulations do not support
+//'      step callbacks.
+//' @param callback The function to be called.
+//' @param num_of_events The number of events between two calls (0 to
+//'      ignore the number of events).
+//' @param time_delta The simulated time between two calls (0 to ignore 
+//'      the simulated time).
+//' @seealso `Simulation$clear_step_callback()` to remove the callback.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//' sim$place_cell("A", 500, 500)
+//'
+//' # stop the simulation once "A" has 500 cells
+//' sim$set_step_callback(function(counts) {
+//'                         sum(counts$counts) >= 500
+//'                       }, 1000, 0)
+//' sim$run_up_to_time(100)
+//'
+//' sim$clear_step_callback()
+  .method("set_step_callback", &Simulation::set_step_callback,
+          "Set a function periodically called during the simulation")
+
+//' @name Simulation$clear_step_callback
+//' @title Removes the step callback
+//' @examples
+//' sim <- new(Simulation)
+//' sim$set_step_callback(function(counts) { FALSE }, 1000, 0)
+//'
+//' sim$clear_step_callback()
+  .method("clear_step_callback", &Simulation::clear_step_callback,
+          "Remove the step callback")
+
 //' @name Simulation$sample_cells
 //' @title Sample a tissue rectangle region.
 //' @description This method removes a rectangular region from the simulated
@@ -960,7 +1352,8 @@ RCPP_MODULE(Mutants){
 //' @description This method searches a rectangular tissue sample containing 
 //'        the provided number of cells. The sizes of the sample are also
 //'        provided a parameter of the method. 
-//'        The complexity of this method is O(|tissue rows|*|tissue cols|).
+//'        The complexity of this method is O(|tissue rows|*|tissue cols|)
+//'        and it does not depend on the sample sizes.
 //' @param mutant_name The mutant of the searched cells.
 //' @param num_of_cells The number of cells in the searched sample.
 //' @param width The width of the searched sample.
@@ -981,7 +1374,35 @@ RCPP_MODULE(Mutants){
 //' # find a 10x10 sample containing 80 "B" cells
 //' sim$search_sample("B",80,50,50)
   .method("search_sample", &Simulation::search_sample, 
-          "Search a rectangular sample containing a given number of cells");
+          "Search a rectangular sample containing a given number of cells")
+
+//' @name Simulation$search_densest_sample
+//' @title Search the rectangular sample containing the most cells
+//' @description This method searches the rectangular tissue sample
+//'        having the provided sizes which contains the largest number
+//'        of cells of a mutant.
+//'        The complexity of this method is O(|tissue rows|*|tissue cols|)
+//'        and it does not depend on the sample sizes.
+//' @param mutant_name The mutant of the searched cells.
+//' @param width The width of the searched sample.
+//' @param height The height of the searched sample.
+//' @return The rectangle containing the largest number of cells of the
+//'        mutant among those having the provided sizes.
+//' @examples
+//' sim <- new(Simulation)
+//' sim$death_activation_level <- 50
+//' sim$add_mutant(name = "A", growth_rate = 0.2, death_rate = 0.01)
+//' sim$place_cell("A", 500, 500)
+//' sim$run_up_to_size(species = "A", num_of_cells = 500)
+//'
+//' sim$add_mutant(name = "B", growth_rate = 0.3, death_rate = 0.01)
+//' sim$mutate_progeny(sim$choose_cell_in("A"), "B")
+//' sim$run_up_to_size(species = "B", num_of_cells = 1000)
+//'
+//' # find the 50x50 sample containing the most "B" cells
+//' sim$search_densest_sample("B",50,50)
+  .method("search_densest_sample", &Simulation::search_densest_sample, 
+          "Search the rectangular sample containing the most cells of a mutant");
 
 //' @name recover_simulation
 //' @title Load a simulation
@@ -1023,6 +1444,45 @@ RCPP_MODULE(Mutants){
   function("recover_simulation", &Simulation::load,
            "Recover a simulation");
 
+//' @name run_simulation_ensemble
+//' @title Simulate many independent replicates of a setup
+//' @description This function builds one simulation per random seed,
+//'      configures each of them by calling `setup`, evolves all of them
+//'      up to the same simulated time on a pool of threads, and returns
+//'      the requested outputs of each replicate. The replicates do not
+//'      save snapshots on disk and the step callback is not called
+//'      during their evolution.
+//' @param setup A function taking as parameter a simulation and
+//'      configuring it (e.g., by adding mutants and placing cells).
+//' @param seeds The vector of the replicate random seeds.
+//' @param time The final simulation time.
+//' @param outputs The vector of the outputs to be collected among
+//'      "counts", "count_history", "firing_history", "samples_forest",
+//'      and "simulation" (default: "counts").
+//' @param num_threads The number of threads (default: 1).
+//' @param finalize A function taking as parameter a simulation and
+//'      called on each replicate at the end of its evolution before
+//'      collecting the outputs, e.g., to sample cells (default: NULL).
+//' @return A list containing, for each replicate, a list reporting
+//'      the "seed" and the requested outputs. The "samples_forest"
+//'      output is `NULL` if no sample has been collected.
+//' @examples
+//' setup <- function(sim) {
+//'   sim$add_mutant("A", growth_rate = 0.2, death_rate = 0.1)
+//'   sim$place_cell("A", 500, 500)
+//' }
+//'
+//' # simulate 4 replicates up to time 30 using 2 threads
+//' ensemble <- run_simulation_ensemble(setup, seeds = 1:4, time = 30,
+//'                                     num_threads = 2)
+//'
+//' ensemble[[1]]$counts
+  function("run_simulation_ensemble", &Simulation::run_ensemble,
+           List::create(_["setup"], _["seeds"], _["time"],
+                        _["outputs"]=std::vector<std::string>{"counts"},
+                        _["num_threads"]=1, _["finalize"]=R_NilValue),
+           "Simulate many independent replicates of a setup");
+
 //' @name SamplesForest
 //' @title The forest of the sampled cell ancestors.
 //' @description Represents the forest of the ancestors of the
@@ -1041,6 +1501,10 @@ RCPP_MODULE(Mutants){
 //'         and the birth time (column "birth_time").
 //' }
 //' @field get_nodes Get the forest nodes \itemize{
+//' \item \emph{Parameter:} \code{compact} - A Boolean flag to produce factor
+//'              columns and ancestor row indices (optional).
+//' \item \emph{Parameter:} \code{skeleton} - A Boolean flag to export only
+//'              the roots and the branching nodes (optional).
 //' \item \emph{Return:} A data frame representing, for each node
 //'              in the forest, the identified (column "id"),
 //'              whenever the node is not a root, the ancestor
@@ -1076,6 +1540,13 @@ RCPP_MODULE(Mutants){
 
 //' @name SamplesForest$get_nodes
 //' @title Get the nodes of the forest
+//' @param compact A Boolean flag to encode the columns "mutant", "epistate",
+//'         and "sample" as factors and to add the column "ancestor_index"
+//'         reporting the row of the ancestor in the data frame (optional).
+//' @param skeleton A Boolean flag to export only the roots and the nodes
+//'         having at least two children, i.e., the coalescent skeleton
+//'         of the forest. When it is set, the column "ancestor" reports
+//'         the nearest ancestor in the skeleton (optional).
 //' @return A data frame representing, for each node
 //'         in the forest, the identified (column "cell_id"),
 //'         whenever the node is not a root, the ancestor
@@ -1103,8 +1574,15 @@ RCPP_MODULE(Mutants){
 //' forest <- sim$get_samples_forest()
 //'
 //' forest$get_nodes()
+//'
+//' # get the branching structure of the forest with factor columns
+//' forest$get_nodes(TRUE, TRUE)
     .method("get_nodes", (List (SamplesForest::*)() const)(&SamplesForest::get_nodes),
             "Get the nodes of the forest")
+    .method("get_nodes", (List (SamplesForest::*)(const bool&) const)(&SamplesForest::get_nodes),
+            "Get the nodes of the forest")
+    .method("get_nodes", (List (SamplesForest::*)(const bool&, const bool&) const)(&SamplesForest::get_nodes),
+            "Get the nodes of the forest")
 
 //' @name SamplesForest$get_coalescent_cells
 //' @title Retrieve most recent common ancestors
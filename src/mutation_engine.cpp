@@ -15,6 +15,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <map>
+#include <memory>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
 #include <sstream>
@@ -30,8 +33,10 @@
 #include <progress_bar.hpp>
 
 #include "mutation_engine.hpp"
+#include "mutation_set.hpp"
 
 #include "genomic_data_storage.hpp"
+#include "parallel_tasks.hpp"
 
 struct MutationEngineSetup
 {
@@ -213,6 +218,43 @@ build_contex_index(const GenomicDataStorage& storage, const size_t context_sampl
   return context_index;
 }
 
+/**
+ * @brief Get a shared context index
+ *
+ * The context indices loaded in the current process are cached and
+ * shared among all the mutation engines using the same storage and 
+ * context sampling. Hence, only the first engine pays for the 
+ * index loading. However, every RACES mutation engine built from the
+ * cached index keeps its own copy of it, because it updates the index
+ * while placing mutations.
+ *
+ * @param storage is the genomic data storage
+ * @param context_sampling is the context sampling rate
+ * @return a shared pointer to the requested context index
+ */
+template<typename ABSOLUTE_GENOTYPE_POSITION = uint32_t>
+std::shared_ptr<const Races::Mutations::ContextIndex<ABSOLUTE_GENOTYPE_POSITION>>
+get_shared_context_index(const GenomicDataStorage& storage, const size_t context_sampling)
+{
+  using Index = Races::Mutations::ContextIndex<ABSOLUTE_GENOTYPE_POSITION>;
+
+  static std::map<std::filesystem::path, std::weak_ptr<const Index>> loaded_indices;
+
+  const auto index_path = std::filesystem::absolute(get_context_index_path(storage,
+                                                                           context_sampling));
+
+  auto& cached_index = loaded_indices[index_path];
+
+  auto context_index = cached_index.lock();
+  if (context_index == nullptr || !std::filesystem::exists(index_path)) {
+    context_index = std::make_shared<const Index>(build_contex_index<ABSOLUTE_GENOTYPE_POSITION>(storage,
+                                                                                                 context_sampling));
+    cached_index = context_index;
+  }
+
+  return context_index;
+}
+
 template<typename ABSOLUTE_GENOTYPE_POSITION>
 std::map<Races::Mutations::ChromosomeId, size_t>
 get_num_of_alleles(const Races::Mutations::ContextIndex<ABSOLUTE_GENOTYPE_POSITION>& context_index,
@@ -240,14 +282,159 @@ get_num_of_alleles(const Races::Mutations::ContextIndex<ABSOLUTE_GENOTYPE_POSITI
   return alleles_per_chromosome;
 }
 
-std::map<std::string, Races::Mutations::MutationalSignature> 
+/**
+ * @brief Get the cached content of a static input file
+ *
+ * The SBS and the passenger CNA files never change during a session,
+ * but they used to be parsed at every mutation engine construction
+ * and reset. This function parses a file once and shares the result 
+ * among all the calls until the file path, size, or last modification 
+ * time change.
+ *
+ * @tparam DATA is the type of the parsed data
+ * @tparam LOADER is the type of the parsing function
+ * @param source_path is the path of the input file
+ * @param key is an additional key identifying the parsing options
+ * @param loader is a function that parses the input file
+ * @return a shared pointer to the parsed data
+ */
+template<typename DATA, typename LOADER>
+std::shared_ptr<const DATA>
+get_cached_source(const std::filesystem::path& source_path, const std::string& key,
+                  LOADER loader)
+{
+  struct CachedSource
+  {
+    std::uintmax_t size;
+    std::filesystem::file_time_type last_write_time;
+    std::shared_ptr<const DATA> data;
+  };
+
+  static std::map<std::pair<std::filesystem::path, std::string>, CachedSource> cache;
+
+  const auto abs_path = std::filesystem::absolute(source_path);
+  const auto size = std::filesystem::file_size(abs_path);
+  const auto last_write_time = std::filesystem::last_write_time(abs_path);
+
+  auto& cached = cache[{abs_path, key}];
+  if (cached.data == nullptr || cached.size != size
+      || cached.last_write_time != last_write_time) {
+    cached.data = std::make_shared<const DATA>(loader(abs_path));
+    cached.size = size;
+    cached.last_write_time = last_write_time;
+  }
+
+  return cached.data;
+}
+
+std::shared_ptr<const std::map<std::string, Races::Mutations::MutationalSignature>>
 load_SBS(const GenomicDataStorage& storage)
 {
-  std::ifstream is(storage.get_SBS_path());
+  using SBSMap = std::map<std::string, Races::Mutations::MutationalSignature>;
 
-  return Races::Mutations::MutationalSignature::read_from_stream(is);
+  return get_cached_source<SBSMap>(storage.get_SBS_path(), "",
+                                   [](const std::filesystem::path& SBS_path) {
+                                     std::ifstream is(SBS_path);
+
+                                     return Races::Mutations::MutationalSignature::read_from_stream(is);
+                                   });
 }
 
+/**
+ * @brief The SBS file table
+ *
+ * This structure stores the tab-separated SBS file as columns so
+ * that the SBS data frame can be built without calling R.
+ */
+struct SBSTable
+{
+  std::vector<std::string> column_names;    //!< The column names
+  std::vector<std::string> types;           //!< The first column, i.e., the SBS types
+  std::vector<std::vector<double>> values;  //!< The signature columns
+
+  explicit SBSTable(const std::filesystem::path& SBS_path)
+  {
+    std::ifstream is(SBS_path);
+    if (!is.good()) {
+      throw std::runtime_error("Cannot open the SBS file " + to_string(SBS_path) + ".");
+    }
+
+    std::string line;
+    if (std::getline(is, line)) {
+      column_names = split(line);
+    }
+    if (column_names.size() == 0) {
+      throw std::runtime_error("The SBS file " + to_string(SBS_path) 
+                               + " has no header.");
+    }
+
+    values.resize(column_names.size()-1);
+
+    while (std::getline(is, line)) {
+      if (line.size() == 0 || line == "\r") {
+        continue;
+      }
+      const auto fields = split(line);
+
+      types.push_back(fields[0]);
+      for (size_t i=1; i<column_names.size(); ++i) {
+        values[i-1].push_back(i<fields.size()?to_double(fields[i]):NA_REAL);
+      }
+    }
+  }
+
+  Rcpp::List get_dataframe() const
+  {
+    Rcpp::List columns(column_names.size());
+
+    columns[0] = Rcpp::wrap(types);
+    for (size_t i=1; i<column_names.size(); ++i) {
+      columns[i] = Rcpp::wrap(values[i-1]);
+    }
+
+    columns.attr("names") = Rcpp::wrap(column_names);
+    columns.attr("row.names") = Rcpp::IntegerVector::create(NA_INTEGER,
+                                                            -static_cast<int>(types.size()));
+    columns.attr("class") = "data.frame";
+
+    return columns;
+  }
+
+private:
+  static std::vector<std::string> split(const std::string& line)
+  {
+    std::vector<std::string> fields;
+
+    std::istringstream iss(line);
+    std::string field;
+    while (std::getline(iss, field, '\t')) {
+      if (field.size()>0 && field.back() == '\r') {
+        field.pop_back();
+      }
+      fields.push_back(field);
+    }
+
+    return fields;
+  }
+
+  static double to_double(const std::string& field)
+  {
+    char* end;
+    const double value = std::strtod(field.c_str(), &end);
+
+    if (end == field.c_str() || *end != '\0') {
+      return NA_REAL;
+    }
+
+    return value;
+  }
+
+  static std::string to_string(const std::filesystem::path& path)
+  {
+    return "\"" + path.string() + "\"";
+  }
+};
+
 Races::Mutations::GenomicRegion get_CNA_region(const Races::IO::CSVReader::CSVRow& row, const size_t& row_num)
 {
   using namespace Races::Mutations;
@@ -290,8 +477,8 @@ Races::Mutations::GenomicRegion get_CNA_region(const Races::IO::CSVReader::CSVRo
 }
 
 
-std::vector<Races::Mutations::CopyNumberAlteration> load_passenger_CNAs(const std::filesystem::path& CNAs_csv,
-                                                                        const std::string& tumor_type)
+std::vector<Races::Mutations::CopyNumberAlteration> parse_passenger_CNAs(const std::filesystem::path& CNAs_csv,
+                                                                         const std::string& tumor_type)
 {
   using namespace Races::Mutations;
 
@@ -336,9 +523,20 @@ std::vector<Races::Mutations::CopyNumberAlteration> load_passenger_CNAs(const st
   return CNAs;
 }
 
+std::shared_ptr<const std::vector<Races::Mutations::CopyNumberAlteration>>
+load_passenger_CNAs(const std::filesystem::path& CNAs_csv, const std::string& tumor_type)
+{
+  using CNAVector = std::vector<Races::Mutations::CopyNumberAlteration>;
+
+  return get_cached_source<CNAVector>(CNAs_csv, tumor_type,
+                                      [&tumor_type](const std::filesystem::path& CNAs_path) {
+                                        return parse_passenger_CNAs(CNAs_path, tumor_type);
+                                      });
+}
+
 void MutationEngine::init_mutation_engine()
 {
-  context_index = build_contex_index<MutationEngine::AbsGenotypePosition>(storage, context_sampling);
+  context_index = get_shared_context_index<MutationEngine::AbsGenotypePosition>(storage, context_sampling);
 
   reset();
 }
@@ -511,9 +709,31 @@ std::list<CPP_TYPE> get_super_object_list(const Rcpp::List& rcpp_list)
   return cpp_list;
 }
 
+template<typename CPP_TYPE, typename RCPP_TYPE>
+void add_drivers(std::list<Races::Mutations::SNV>& c_snvs,
+                 std::list<Races::Mutations::CopyNumberAlteration>& c_cnas,
+                 std::list<CPP_TYPE>& c_list, const SEXP& drivers)
+{
+  if (MutationSet::is_mutation_set(drivers)) {
+    // unwrap the set once without copying it
+    const auto* mutation_set = Rcpp::as<MutationSet*>(drivers);
+
+    const auto& set_SNVs = mutation_set->get_SNV_vector();
+    c_snvs.insert(c_snvs.end(), set_SNVs.begin(), set_SNVs.end());
+
+    const auto& set_CNAs = mutation_set->get_CNA_vector();
+    c_cnas.insert(c_cnas.end(), set_CNAs.begin(), set_CNAs.end());
+
+    return;
+  }
+
+  c_list.splice(c_list.end(),
+                get_super_object_list<CPP_TYPE, RCPP_TYPE>(Rcpp::List(drivers)));
+}
+
 void MutationEngine::add_mutant(const std::string& mutant_name,
                                 const Rcpp::List& epistate_passenger_rates,
-                                const Rcpp::List& driver_SNVs)
+                                const SEXP& driver_SNVs)
 {
   Rcpp::List empty_list;
 
@@ -708,11 +928,15 @@ void retrieve_missing_references(const std::string& mutant_name,
 
 void MutationEngine::add_mutant(const std::string& mutant_name,
                                 const Rcpp::List& epistate_passenger_rates,
-                                const Rcpp::List& driver_SNVs,
-                                const Rcpp::List& driver_CNAs)
+                                const SEXP& driver_SNVs,
+                                const SEXP& driver_CNAs)
 {
-  auto c_snvs = get_super_object_list<Races::Mutations::SNV, SNV>(driver_SNVs);
-  auto c_cnas = get_super_object_list<Races::Mutations::CopyNumberAlteration, CNA>(driver_CNAs);
+  std::list<Races::Mutations::SNV> c_snvs;
+  std::list<Races::Mutations::CopyNumberAlteration> c_cnas;
+
+  add_drivers<Races::Mutations::SNV, SNV>(c_snvs, c_cnas, c_snvs, driver_SNVs);
+  add_drivers<Races::Mutations::CopyNumberAlteration, CNA>(c_snvs, c_cnas, c_cnas,
+                                                           driver_CNAs);
 
   retrieve_missing_references(mutant_name, storage.get_reference_path(), c_snvs);
 
@@ -735,18 +959,117 @@ PhylogeneticForest MutationEngine::place_mutations(const SamplesForest& forest,
 
   progress_bar.set_message("Placing mutations");
 
+  Profiler::ScopedTimer timer(profiler.get(), "mutation placement");
+
   auto phylo_forest = m_engine.place_mutations(forest, num_of_preneoplatic_mutations, progress_bar, seed);
 
   progress_bar.set_message("Mutations placed");
 
+  Profiler::add(profiler.get(), "emerged SNVs", phylo_forest.get_SNV_first_cells().size(),
+                "mutation placement");
+  Profiler::add(profiler.get(), "emerged CNAs", phylo_forest.get_CNA_first_cells().size(),
+                "mutation placement");
+
   return {std::move(phylo_forest), storage.get_reference_path(), m_engine.get_timed_exposures()};
 }
 
+Rcpp::List MutationEngine::place_mutations_batch(const SamplesForest& forest,
+                                                 const size_t& num_of_preneoplatic_mutations,
+                                                 const std::vector<int>& seeds,
+                                                 const std::vector<std::string>& subjects,
+                                                 const SEXP& consumer)
+{
+  using namespace Rcpp;
+
+  if (subjects.size()>1 && subjects.size() != seeds.size()) {
+    throw std::domain_error("The subject vector must contain either at most one subject "
+                            "or one subject per seed.");
+  }
+
+  const bool save_forests = Rf_isString(consumer);
+  if (!save_forests && !Rf_isFunction(consumer)) {
+    throw std::domain_error("The consumer must be either a directory name or a function.");
+  }
+
+  std::filesystem::path output_dir;
+  if (save_forests) {
+    output_dir = as<std::string>(consumer);
+    std::filesystem::create_directories(output_dir);
+  }
+
+  const auto original_subject = germline_subject;
+
+  // the subjects are used in the provided order; switching to a 
+  // subject reloads its germline and never changes the exposures
+  // and the mutant specifications
+  List results(seeds.size());
+  try {
+    Races::UI::ProgressBar progress_bar;
+
+    for (size_t i=0; i<seeds.size(); ++i) {
+      if (subjects.size()>0) {
+        const auto& subject = subjects[(subjects.size()==1?0:i)];
+        if (subject != germline_subject) {
+          set_germline_subject(subject);
+        }
+      }
+
+      progress_bar.set_message("Placing mutations (" + std::to_string(i+1) + "/"
+                               + std::to_string(seeds.size()) + ")");
+
+      PhylogeneticForest phylo_forest(m_engine.place_mutations(forest, num_of_preneoplatic_mutations,
+                                                               progress_bar, seeds[i]),
+                                      storage.get_reference_path(),
+                                      m_engine.get_timed_exposures());
+
+      // every forest is either saved or reduced before placing the 
+      // mutations of the next replicate
+      if (save_forests) {
+        const auto filename = output_dir/("phylo_forest_" + std::to_string(i+1) + ".sff");
+
+        phylo_forest.save(filename);
+
+        results[i] = std::string(filename);
+      } else {
+        Function reducer(consumer);
+
+        // the forest is moved, rather than copied, into an R object:
+        // from now on R owns it and its garbage collector releases it
+        // once no reference to it is left
+        RObject R_forest = internal::make_new_object(new PhylogeneticForest(std::move(phylo_forest)));
+
+        results[i] = reducer(R_forest);
+      }
+    }
+
+    progress_bar.set_message("Mutations placed");
+  } catch (...) {
+    // restore the original subject, but report the original error
+    if (germline_subject != original_subject) {
+      try {
+        set_germline_subject(original_subject);
+      } catch (...) {
+      }
+    }
+
+    throw;
+  }
+
+  if (germline_subject != original_subject) {
+    set_germline_subject(original_subject);
+  }
+
+  return results;
+}
+
 Rcpp::List MutationEngine::get_SBS_dataframe()
 {
-  Rcpp::Function read_delim("read.delim");
+  auto SBS_table = get_cached_source<SBSTable>(storage.get_SBS_path(), "",
+                                               [](const std::filesystem::path& SBS_path) {
+                                                 return SBSTable(SBS_path);
+                                               });
 
-  return read_delim(std::string(storage.get_SBS_path()), Rcpp::_["quote"]="");
+  return SBS_table->get_dataframe();
 }
 
 template<typename OUT, typename ITERATOR>
@@ -825,14 +1148,30 @@ void MutationEngine::rebuild_context_index()
 
   std::filesystem::remove(context_index_path);
 
-  context_index = build_contex_index(storage, context_sampling);
+  Profiler::ScopedTimer timer(profiler.get(), "context index construction");
+
+  context_index = get_shared_context_index<MutationEngine::AbsGenotypePosition>(storage, context_sampling);
+
+  reset(false);
 }
 
 void MutationEngine::set_context_sampling(const size_t& context_sampling)
 {
+  if (context_sampling == 0) {
+    throw std::domain_error("The context sampling rate must be a positive number.");
+  }
+
+  if (this->context_sampling == context_sampling) {
+    return;
+  }
+
   this->context_sampling = context_sampling;
 
-  context_index = build_contex_index(storage, context_sampling);
+  Profiler::ScopedTimer timer(profiler.get(), "context index loading");
+
+  context_index = get_shared_context_index<MutationEngine::AbsGenotypePosition>(storage, context_sampling);
+
+  reset(false);
 }
 
 void MutationEngine::reset(const bool full)
@@ -847,6 +1186,8 @@ void MutationEngine::reset(const bool full)
     timed_exposures = m_engine.get_timed_exposures();
   }
 
+  Profiler::ScopedTimer timer(profiler.get(), "engine reset");
+
   auto SBS = load_SBS(storage);
 
   auto passenger_CNAs = load_passenger_CNAs(storage.get_passenger_CNAs_path(),
@@ -868,9 +1209,9 @@ void MutationEngine::reset(const bool full)
 
   auto germline = germline_storage.get_germline(germline_subject);
 
-  m_engine = Races::Mutations::MutationEngine(context_index, SBS,
+  m_engine = Races::Mutations::MutationEngine(*context_index, *SBS,
                                               mutational_properties, germline,
-                                              driver_storage, passenger_CNAs);
+                                              driver_storage, *passenger_CNAs);
 
   for (const auto& [time, exposure] : timed_exposures) {
     m_engine.add(time, exposure);
@@ -885,3 +1226,25 @@ void MutationEngine::set_germline_subject(const std::string& germline_subject)
 
   reset(false);
 }
+
+void MutationEngine::set_profiling(const bool& enabled)
+{
+  if (!enabled) {
+    profiler.reset();
+  } else if (!profiler) {
+    profiler = std::make_shared<Profiler>();
+  }
+}
+
+void MutationEngine::precompile_germlines(const int& num_threads) const
+{
+  using namespace Rcpp;
+
+  const auto num_workers = validate_num_threads(num_threads);
+
+  Rcout << "Building germline binaries..." << std::flush;
+
+  const auto built = storage.get_germline_storage().precompile_germlines(num_workers);
+
+  Rcout << "done (" << built << " built)" << std::endl;
+}
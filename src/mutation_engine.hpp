@@ -19,6 +19,7 @@
 #define __RRACES_MUTATION_ENGINE__
 
 #include <string>
+#include <memory>
 
 #include <Rcpp.h>
 
@@ -30,6 +31,7 @@
 #include "samples_forest.hpp"
 
 #include "genomic_data_storage.hpp"
+#include "profiler.hpp"
 
 class MutationEngine
 {
@@ -41,9 +43,11 @@ class MutationEngine
     size_t context_sampling;
     std::string tumor_type;
 
-    Races::Mutations::ContextIndex<AbsGenotypePosition> context_index;
+    std::shared_ptr<const Races::Mutations::ContextIndex<AbsGenotypePosition>> context_index;
     Races::Mutations::MutationEngine<AbsGenotypePosition, std::mt19937_64> m_engine;
 
+    std::shared_ptr<Profiler> profiler;  //!< The profiler (null when disabled)
+
     GermlineSubject get_germline_subject(const std::string& subject_name) const;
 
     void init_mutation_engine();
@@ -70,10 +74,10 @@ public:
     void add_exposure(const double& time, const Rcpp::List& exposure);
 
     void add_mutant(const std::string& mutant_name, const Rcpp::List& passenger_rates,
-                    const Rcpp::List& driver_SNVs);
+                    const SEXP& driver_SNVs);
 
     void add_mutant(const std::string& mutant_name, const Rcpp::List& passenger_rates,
-                    const Rcpp::List& driver_SNVs, const Rcpp::List& driver_CNAs);
+                    const SEXP& driver_SNVs, const SEXP& driver_CNAs);
 
     inline Rcpp::List get_active_germline() const
     {
@@ -92,6 +96,13 @@ public:
 
     void set_germline_subject(const std::string& germline_subject);
 
+    void precompile_germlines(const int& num_threads) const;
+
+    inline void precompile_germlines() const
+    {
+        precompile_germlines(1);
+    }
+
     PhylogeneticForest place_mutations(const SamplesForest& forest,
                                        const size_t& num_of_preneoplatic_mutations,
                                        const int seed);
@@ -102,6 +113,12 @@ public:
         return place_mutations(forest, num_of_preneoplatic_mutations, 0);
     }
 
+    Rcpp::List place_mutations_batch(const SamplesForest& forest,
+                                     const size_t& num_of_preneoplatic_mutations,
+                                     const std::vector<int>& seeds,
+                                     const std::vector<std::string>& subjects,
+                                     const SEXP& consumer);
+
     Rcpp::List get_SBS_dataframe();
 
     void show() const;
@@ -123,6 +140,13 @@ public:
     void rebuild_context_index();
 
     void reset(const bool full=true);
+
+    void set_profiling(const bool& enabled);
+
+    inline Rcpp::List get_profile() const
+    {
+        return Profiler::get_dataframe(profiler.get());
+    }
 };
 
 RCPP_EXPOSED_CLASS(MutationEngine)
@@ -0,0 +1,239 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include "mutation_set.hpp"
+#include "cna.hpp"
+
+MutationSet::MutationSet()
+{}
+
+Rcpp::List MutationSet::get_SNVs() const
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  CharacterVector chr_names(SNVs.size()), ref_bases(SNVs.size()),
+                  alt_bases(SNVs.size()), causes(SNVs.size());
+  IntegerVector positions(SNVs.size());
+
+  size_t i{0};
+  for (const auto& snv : SNVs) {
+    chr_names[i] = GenomicPosition::chrtos(snv.chr_id);
+    positions[i] = snv.position;
+    ref_bases[i] = std::string(1, snv.ref_base);
+    alt_bases[i] = std::string(1, snv.alt_base);
+    if (snv.cause == "") {
+      causes[i] = NA_STRING;
+    } else {
+      causes[i] = snv.cause;
+    }
+
+    ++i;
+  }
+
+  return DataFrame::create(_["chromosome"]=chr_names,
+                           _["pos_in_chr"]=positions,
+                           _["ref"]=ref_bases,
+                           _["alt"]=alt_bases,
+                           _["cause"]=causes);
+}
+
+Rcpp::List MutationSet::get_CNAs() const
+{
+  return get_CNA_dataframe(CNAs);
+}
+
+void MutationSet::show() const
+{
+  using namespace Rcpp;
+
+  Rcout << "MutationSet(SNVs: " << SNVs.size()
+        << ", CNAs: " << CNAs.size() << ")" << std::endl;
+}
+
+bool MutationSet::is_mutation_set(const SEXP& object)
+{
+  return Rf_isS4(object) && Rf_inherits(object, "Rcpp_MutationSet");
+}
+
+SEXP get_column(const Rcpp::DataFrame& dataframe, const std::string& name)
+{
+  if (!dataframe.containsElementNamed(name.c_str())) {
+    throw std::domain_error("The data frame has no column \"" + name + "\".");
+  }
+
+  return dataframe[name];
+}
+
+std::string row_description(const R_xlen_t& row)
+{
+  return " in row " + std::to_string(row+1) + ".";
+}
+
+Races::Mutations::ChrPosition get_position(const Rcpp::NumericVector& values,
+                                           const R_xlen_t& row,
+                                           const std::string& column_name)
+{
+  if (Rcpp::NumericVector::is_na(values[row]) || values[row] < 0) {
+    throw std::domain_error("The column \"" + column_name + "\" must contain "
+                            + "non-negative numbers: "
+                            + std::to_string(values[row])
+                            + row_description(row));
+  }
+
+  return static_cast<Races::Mutations::ChrPosition>(values[row]);
+}
+
+char get_base(const Rcpp::CharacterVector& bases, const R_xlen_t& row,
+              const std::string& column_name)
+{
+  SEXP base = STRING_ELT(bases, row);
+  if (base == NA_STRING || Rf_length(base) != 1) {
+    throw std::domain_error("The column \"" + column_name + "\" must contain "
+                            + "single nucleotides" + row_description(row));
+  }
+
+  return CHAR(base)[0];
+}
+
+Races::Mutations::AlleleId get_allele(const Rcpp::IntegerVector& alleles,
+                                      const R_xlen_t& row,
+                                      const std::string& column_name)
+{
+  if (Rcpp::IntegerVector::is_na(alleles[row])) {
+    return RANDOM_ALLELE;
+  }
+
+  if (alleles[row] < 0) {
+    throw std::domain_error("The column \"" + column_name + "\" must contain "
+                            + "either non-negative numbers or NA"
+                            + row_description(row));
+  }
+
+  return static_cast<Races::Mutations::AlleleId>(alleles[row]);
+}
+
+MutationSet MutationSet::build_SNVs(const Rcpp::DataFrame& SNV_df)
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  // these conversions coerce, e.g., numeric chromosome names
+  CharacterVector chr_names = get_column(SNV_df, "chromosome");
+  NumericVector positions = get_column(SNV_df, "pos_in_chr");
+  CharacterVector alt_bases = get_column(SNV_df, "alt");
+
+  CharacterVector ref_bases, causes;
+  const bool has_ref = SNV_df.containsElementNamed("ref");
+  if (has_ref) {
+    ref_bases = SNV_df["ref"];
+  }
+  const bool has_cause = SNV_df.containsElementNamed("cause");
+  if (has_cause) {
+    causes = SNV_df["cause"];
+  }
+
+  MutationSet mutation_set;
+
+  mutation_set.SNVs.reserve(chr_names.size());
+  for (R_xlen_t i=0; i<chr_names.size(); ++i) {
+    if (CharacterVector::is_na(chr_names[i])) {
+      throw std::domain_error("Missing chromosome" + row_description(i));
+    }
+    const auto chr_id = GenomicPosition::stochr(as<std::string>(chr_names[i]));
+
+    const auto pos = get_position(positions, i, "pos_in_chr");
+    const char alt_base = get_base(alt_bases, i, "alt");
+
+    // '?' requests the reference base to be read from the reference
+    // sequence when the set is added to a mutation engine
+    char ref_base = '?';
+    if (has_ref && !CharacterVector::is_na(ref_bases[i])) {
+      ref_base = get_base(ref_bases, i, "ref");
+    }
+
+    std::string cause;
+    if (has_cause && !CharacterVector::is_na(causes[i])) {
+      cause = as<std::string>(causes[i]);
+    }
+
+    mutation_set.SNVs.emplace_back(chr_id, pos, ref_base, alt_base, cause);
+  }
+
+  return mutation_set;
+}
+
+MutationSet MutationSet::build_CNAs(const Rcpp::DataFrame& CNA_df)
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  CharacterVector types = get_column(CNA_df, "type");
+  CharacterVector chr_names = get_column(CNA_df, "chromosome");
+  NumericVector positions = get_column(CNA_df, "pos_in_chr");
+
+  // accept both the `CNA()` parameter name and the data frame column
+  // produced by `get_CNAs()`
+  const std::string len_name = (CNA_df.containsElementNamed("len")?
+                                "len":"length");
+  NumericVector lengths = get_column(CNA_df, len_name);
+
+  IntegerVector alleles(types.size(), NA_INTEGER),
+                src_alleles(types.size(), NA_INTEGER);
+  if (CNA_df.containsElementNamed("allele")) {
+    alleles = CNA_df["allele"];
+  }
+  if (CNA_df.containsElementNamed("src_allele")) {
+    src_alleles = CNA_df["src_allele"];
+  }
+
+  MutationSet mutation_set;
+
+  mutation_set.CNAs.reserve(types.size());
+  for (R_xlen_t i=0; i<types.size(); ++i) {
+    if (CharacterVector::is_na(chr_names[i])) {
+      throw std::domain_error("Missing chromosome" + row_description(i));
+    }
+    const auto chr_id = GenomicPosition::stochr(as<std::string>(chr_names[i]));
+
+    GenomicPosition gen_pos(chr_id, get_position(positions, i, "pos_in_chr"));
+    GenomicRegion region(gen_pos, get_position(lengths, i, len_name));
+
+    const auto allele = get_allele(alleles, i, "allele");
+
+    const std::string type = (CharacterVector::is_na(types[i])?
+                              "NA":as<std::string>(types[i]));
+    if (type == "D") {
+      mutation_set.CNAs.emplace_back(region, CopyNumberAlteration::Type::DELETION,
+                                     allele, allele);
+    } else if (type == "A") {
+      const auto src_allele = get_allele(src_alleles, i, "src_allele");
+
+      mutation_set.CNAs.emplace_back(region, CopyNumberAlteration::Type::AMPLIFICATION,
+                                     src_allele, allele);
+    } else {
+      throw std::domain_error("Unknown CNA type \"" + type + "\""
+                              + row_description(i) + " Supported types are "
+                              + "\"A\" and \"D\" for amplification and "
+                              + "deletion, respectively.");
+    }
+  }
+
+  return mutation_set;
+}
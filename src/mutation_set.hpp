@@ -0,0 +1,79 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RRACES_MUTATION_SET__
+#define __RRACES_MUTATION_SET__
+
+#include <vector>
+
+#include <snv.hpp>
+#include <cna.hpp>
+
+#include <Rcpp.h>
+
+/**
+ * @brief A set of driver SNVs and CNAs
+ *
+ * This class stores the mutations as RACES objects built directly from
+ * the columns of a data frame. No R object is created per mutation and
+ * the whole set is unwrapped once when it is passed to
+ * `MutationEngine::add_mutant()`.
+ */
+class MutationSet
+{
+    std::vector<Races::Mutations::SNV> SNVs;    //!< The SNVs in the set
+    std::vector<Races::Mutations::CopyNumberAlteration> CNAs;   //!< The CNAs in the set
+
+public:
+    MutationSet();
+
+    inline const std::vector<Races::Mutations::SNV>& get_SNV_vector() const
+    {
+        return SNVs;
+    }
+
+    inline const std::vector<Races::Mutations::CopyNumberAlteration>& get_CNA_vector() const
+    {
+        return CNAs;
+    }
+
+    inline size_t get_num_of_SNVs() const
+    {
+        return SNVs.size();
+    }
+
+    inline size_t get_num_of_CNAs() const
+    {
+        return CNAs.size();
+    }
+
+    Rcpp::List get_SNVs() const;
+
+    Rcpp::List get_CNAs() const;
+
+    void show() const;
+
+    static bool is_mutation_set(const SEXP& object);
+
+    static MutationSet build_SNVs(const Rcpp::DataFrame& SNV_df);
+
+    static MutationSet build_CNAs(const Rcpp::DataFrame& CNA_df);
+};
+
+RCPP_EXPOSED_CLASS(MutationSet)
+
+#endif // __RRACES_MUTATION_SET__
@@ -23,6 +23,7 @@
 #include "mutation_engine.hpp"
 #include "snv.hpp"
 #include "cna.hpp"
+#include "mutation_set.hpp"
 
 using namespace Rcpp;
 
@@ -280,6 +281,96 @@ RCPP_MODULE(Mutations){
     .method("get_dataframe",&CNA::get_dataframe, "Get a dataframe representing the CNA")
     .method("show",&CNA::show);
 
+//' @name MutationSet
+//' @title A set of driver SNVs and CNAs
+//' @description Mutation sets store many SNVs and CNAs without building
+//'   one R object per mutation. They are built from data frames by the
+//'   functions `SNVs` and `CNAs` and can be passed to
+//'   `MutationEngine$add_mutant` in place of lists of `SNV` and `CNA`
+//'   objects.
+//' @field get_CNAs Get the CNAs in the set \itemize{
+//' \item \emph{Return:} A data frame whose columns are `chromosome`, 
+//'    `pos_in_chr`, `length`, `allele`, `src_allele`, and `type`.
+//' }
+//' @field get_SNVs Get the SNVs in the set \itemize{
+//' \item \emph{Return:} A data frame whose columns are `chromosome`, 
+//'    `pos_in_chr`, `ref`, `alt`, and `cause`.
+//' }
+  class_<MutationSet>("MutationSet")
+    .constructor()
+
+//' @name MutationSet$get_SNVs
+//' @title Get the SNVs in a mutation set.
+//' @return A data frame whose columns are `chromosome`, `pos_in_chr`,
+//'        `ref`, `alt`, and `cause`.
+//' @examples
+//' snvs <- SNVs(data.frame(chromosome = c("22", "X"),
+//'                         pos_in_chr = c(10510210, 20002),
+//'                         alt = c("C", "T")))
+//'
+//' snvs$get_SNVs()
+    .method("get_SNVs", &MutationSet::get_SNVs, "Get the SNVs in the set")
+
+//' @name MutationSet$get_CNAs
+//' @title Get the CNAs in a mutation set.
+//' @return A data frame whose columns are `chromosome`, `pos_in_chr`,
+//'        `length`, `allele`, `src_allele`, and `type`.
+//' @examples
+//' cnas <- CNAs(data.frame(type = c("A", "D"), chromosome = c("22", "22"),
+//'                         pos_in_chr = c(10303470, 5010000),
+//'                         len = c(200000, 200000)))
+//'
+//' cnas$get_CNAs()
+    .method("get_CNAs", &MutationSet::get_CNAs, "Get the CNAs in the set")
+    .method("show", &MutationSet::show);
+
+//' @name SNVs
+//' @title Create a set of SNVs from a data frame.
+//' @description This function builds a mutation set containing one SNV
+//'        per row of a data frame without creating any R object per SNV.
+//' @param SNV_df A data frame whose columns `chromosome`, `pos_in_chr`,
+//'        and `alt` are the chromosome names, the positions in the
+//'        chromosome, and the bases after the mutations, respectively.
+//'        The optional columns `ref` and `cause` contain the bases
+//'        before the mutations and the SNV causes; an `NA` reference
+//'        base is read from the reference sequence when the set is
+//'        added to a mutation engine.
+//' @return A `MutationSet` containing the SNVs.
+//' @seealso `SNV` to build a single SNV; `MutationEngine$add_mutant` to 
+//'        use the set as mutant genomic characterization.
+//' @examples
+//' snvs <- SNVs(data.frame(chromosome = c("22", "X"),
+//'                         pos_in_chr = c(10510210, 20002),
+//'                         alt = c("C", "T"), ref = c(NA, "A")))
+//'
+//' snvs
+  function("SNVs", &MutationSet::build_SNVs, List::create(_["SNV_df"]),
+           "Create a set of SNVs from a data frame");
+
+//' @name CNAs
+//' @title Create a set of CNAs from a data frame.
+//' @description This function builds a mutation set containing one CNA
+//'        per row of a data frame without creating any R object per CNA.
+//' @param CNA_df A data frame whose columns `type`, `chromosome`,
+//'        `pos_in_chr`, and `len` (or `length`) are the CNA types, i.e., 
+//'        "A" or "D" for amplification and deletion, respectively, the 
+//'        chromosome names, the positions in the chromosome, and the 
+//'        CNA lengths. The optional columns `allele` and `src_allele` 
+//'        contain the alleles in which the CNAs occur and, for 
+//'        amplifications, the alleles from which the regions are 
+//'        amplified; `NA` stands for a random allele.
+//' @return A `MutationSet` containing the CNAs.
+//' @seealso `CNA` to build a single CNA; `MutationEngine$add_mutant` to 
+//'        use the set as mutant genomic characterization.
+//' @examples
+//' cnas <- CNAs(data.frame(type = c("A", "D"), chromosome = c("22", "22"),
+//'                         pos_in_chr = c(10303470, 5010000),
+//'                         len = c(200000, 200000), allele = c(NA, 0)))
+//'
+//' cnas
+  function("CNAs", &MutationSet::build_CNAs, List::create(_["CNA_df"]),
+           "Create a set of CNAs from a data frame");
+
 //' @name MutationEngine
 //' @title Mutation engines generate phylogenetic forests
 //' @description A mutation engine can label every node of a descendants 
@@ -352,8 +443,10 @@ RCPP_MODULE(Mutations){
 //' @param passenger_rates The list of the passenger rates whose names are the 
 //'           epigenetic states of the species or a single rate, if the mutant
 //'           does not have an epigenetic state.
-//' @param driver_SNVs The list of the driver SNVs characterizing the mutant.
-//' @param driver_CNAs The list of the driver CNAs characterizing the mutant.
+//' @param driver_SNVs The list of the driver SNVs characterizing the mutant
+//'           or a mutation set built by `SNVs` or `CNAs`.
+//' @param driver_CNAs The list of the driver CNAs characterizing the mutant
+//'           or a mutation set built by `SNVs` or `CNAs`.
 //' @examples
 //' # create a demostrative mutation engine
 //' m_engine <- build_mutation_engine(setup_code = "demo")
@@ -375,13 +468,23 @@ RCPP_MODULE(Mutations){
 //' # rate 5e-9 and passenger CNA rate 0.
 //' m_engine$add_mutant("B", c(SNV = 5e-9), c(SNV("22", 10510210, "C")))
 //'
+//' # add the mutant "C" whose driver mutations are stored in data frames.
+//' # `SNVs` and `CNAs` build mutation sets without creating one
+//' # R object per mutation.
+//' drivers <- data.frame(chromosome = c("22", "22"),
+//'                       pos_in_chr = c(10510210, 10510220),
+//'                       alt = c("C", "A"))
+//' m_engine$add_mutant("C", c(SNV = 5e-9), SNVs(drivers),
+//'                     CNAs(data.frame(type = "D", chromosome = "22",
+//'                                     pos_in_chr = 5010000, len = 200000)))
+//'
 //' m_engine
     .method("add_mutant", (void (MutationEngine::*)(const std::string&, const Rcpp::List& passenger_rates,
-                                                    const Rcpp::List&))(
+                                                    const SEXP&))(
                                                         &MutationEngine::add_mutant),                                            
             "Add mutant")
     .method("add_mutant", (void (MutationEngine::*)(const std::string&, const Rcpp::List& passenger_rates,
-                                                    const Rcpp::List&, const Rcpp::List&))(
+                                                    const SEXP&, const SEXP&))(
                                                         &MutationEngine::add_mutant), 
             "Add mutant")
 
@@ -438,6 +541,64 @@ RCPP_MODULE(Mutations){
                                                         &MutationEngine::place_mutations),
             "Place mutations on a SamplesForest")
 
+//' @name MutationEngine$place_mutations_batch
+//' @title Place mutations on a forest for many seeds and subjects
+//' @description This method places the mutations on a samples forest 
+//'        once per provided seed and it either saves the resulting 
+//'        phylogenetic forests or it reduces them by using a function.
+//'        The forests are processed one at a time. When `consumer` is
+//'        a function, each forest is handed over to R: its memory is
+//'        reclaimed by the garbage collector once `consumer` has
+//'        returned and no longer references it, so some forests may be
+//'        kept in memory until the next garbage collection.
+//' @param samples_forest A samples forest.
+//' @param num_of_preneoplastic_mutations The number of pre-neoplastic 
+//'        mutations.
+//' @param seeds A vector of random seeds: one phylogenetic forest is
+//'        produced for each of them.
+//' @param subjects A vector of germline subjects. It is either empty, to 
+//'        use the active germline subject, a single subject, or one 
+//'        subject per seed. The active germline subject is restored 
+//'        at the end of the computation, even when it fails.
+//' @param consumer Either the name of a directory, where the forests 
+//'        are saved as "phylo_forest_<i>.sff", or a function that 
+//'        is applied to each forest.
+//' @return A list containing either the names of the saved files or the 
+//'        values returned by `consumer`.
+//' @seealso `MutationEngine$place_mutations()` to place the mutations 
+//'        for a single seed.
+//' @examples
+//' # create a simulation
+//' sim <- new(Simulation)
+//' sim$add_mutant("A", c(SNV = 0.2), 0.01)
+//' sim$place_cell("A", 500, 500)
+//'
+//' sim$death_activation_level <- 100
+//' sim$run_up_to_size(species = "A", num_of_cells = 50000)
+//'
+//' # sample the region [450,500]x[475,550]
+//' sim$sample_cells("S1", lower_corner = c(450, 475),
+//'                        upper_corner = c(500, 550))
+//'
+//' # build the samples forest
+//' samples_forest <- sim$get_samples_forest()
+//'
+//' # build a mutation engine
+//' m_engine <- build_mutation_engine(setup_code = "demo")
+//'
+//' m_engine$add_mutant("A", c(SNV = 3e-9),
+//'                     c(SNV("22", 12028576, "G")))
+//' m_engine$add_exposure(c(SBS13 = 0.3, SBS1 = 0.7))
+//'
+//' # count the SNVs of three replicates
+//' num_of_SNVs <- m_engine$place_mutations_batch(samples_forest, 1000,
+//'                                               c(1, 2, 3), character(0),
+//'                                               function(forest) {
+//'                                                 nrow(forest$get_sampled_cell_SNVs())
+//'                                               })
+    .method("place_mutations_batch", &MutationEngine::place_mutations_batch,
+            "Place mutations on a SamplesForest for many seeds")
+
 //' @name MutationEngine$get_active_germline
 //' @title Get a data frame describing the active germline subject
 //' @description This method returns a data frame containing the
@@ -475,6 +636,30 @@ RCPP_MODULE(Mutations){
 //' m_engine$set_germline_subject("NA18941")
     .method("set_germline_subject", &MutationEngine::set_germline_subject)
 
+//' @name MutationEngine$precompile_germlines
+//' @title Build the germline binaries of all the subjects
+//' @description This method builds in parallel the binary germline 
+//'        files of all the available subjects. Once these files have 
+//'        been built, setting the germline subject does not require 
+//'        to parse the germline CSV file anymore. The binary 
+//'        files that already exist are not re-built.
+//' @param num_threads The number of threads (optional: default value 
+//'        is 1).
+//' @seealso `MutationEngine$set_germline_subject()` to set the active
+//'      germline subject.
+//' @examples
+//' # build a mutation engine
+//' m_engine <- build_mutation_engine(setup_code = "demo")
+//'
+//' # build the germline binaries of all the subjects
+//' m_engine$precompile_germlines(2)
+    .method("precompile_germlines", (void (MutationEngine::*)() const)(
+                                                        &MutationEngine::precompile_germlines),
+            "Build the germline binaries of all the subjects")
+    .method("precompile_germlines", (void (MutationEngine::*)(const int&) const)(
+                                                        &MutationEngine::precompile_germlines),
+            "Build the germline binaries of all the subjects")
+
 //' @name MutationEngine$get_germline_subjects
 //' @title Get a data frame reporting the available germline subjects
 //' @description This method returns a data frame containing the
@@ -531,6 +716,67 @@ RCPP_MODULE(Mutations){
     .method("get_SBSs", &MutationEngine::get_SBS_dataframe,
             "Get the SBS data frame")
 
+//' @name MutationEngine$set_context_sampling
+//' @title Set the context sampling rate
+//' @description This method changes the context sampling rate of the
+//'         mutation engine, i.e., the number of context occurrences
+//'         per indexed occurrence. The context index of the new rate 
+//'         is loaded from the set-up directory, if it was previously 
+//'         built, or it is built and saved otherwise. The mutant and 
+//'         exposure specifications are preserved.
+//' @param context_sampling The new context sampling rate.
+//' @examples
+//' # build a mutation engine
+//' m_engine <- build_mutation_engine(setup_code = "demo")
+//'
+//' # use a coarser context index
+//' m_engine$set_context_sampling(200)
+    .method("set_context_sampling", &MutationEngine::set_context_sampling,
+            "Set the context sampling rate")
+
+//' @name MutationEngine$rebuild_context_index
+//' @title Rebuild the context index
+//' @description This method discards the saved context index of the
+//'         current context sampling rate and builds it anew. The
+//'         mutant and exposure specifications are preserved.
+//' @examples
+//' # build a mutation engine
+//' m_engine <- build_mutation_engine(setup_code = "demo")
+//'
+//' # rebuild the context index
+//' m_engine$rebuild_context_index()
+    .method("rebuild_context_index", &MutationEngine::rebuild_context_index,
+            "Rebuild the context index")
+
+//' @name MutationEngine$set_profiling
+//' @title Enables/disables profiling
+//' @description When profiling is enabled, the mutation engine measures the
+//'         time spent in placing mutations, in building and loading context
+//'         indices, and in resetting the engine, and it counts the emerged
+//'         SNVs and CNAs. Disabling profiling discards the collected data.
+//' @param enabled A Boolean flag to enable profiling.
+//' @seealso `MutationEngine$get_profile()` for usage examples
+    .method("set_profiling", &MutationEngine::set_profiling,
+            "Enable/disable profiling")
+
+//' @name MutationEngine$get_profile
+//' @title Gets the profiling report
+//' @return A data frame reporting "name", "type" (either "timer" or
+//'         "counter"), "calls", "value" (the total seconds for timers),
+//'         and "rate" (the counter value per second of the associated
+//'         timer) for each timer and counter.
+//' @examples
+//' # build a mutation engine and enable profiling
+//' m_engine <- build_mutation_engine(setup_code = "demo")
+//' m_engine$set_profiling(TRUE)
+//'
+//' # rebuild the context index
+//' m_engine$rebuild_context_index()
+//'
+//' m_engine$get_profile()
+    .method("get_profile", &MutationEngine::get_profile,
+            "Get the profiling report")
+
     .method("show", &MutationEngine::show);
 
 //' @name build_mutation_engine
@@ -568,7 +814,19 @@ RCPP_MODULE(Mutations){
 //'       of a previous construction, then the corresponding reference
 //'       sequence, the SBS file, and the previously built context index
 //'       are loaded from the set-up directory avoiding further 
-//'       computations.
+//'       computations. Moreover, the mutation engines of the same R 
+//'       session that share the set-up directory and the context 
+//'       sampling load the context index only once. Nevertheless, 
+//'       each of them keeps its own working copy of the index, which
+//'       is updated while placing the mutations.
+//'
+//'       When the simulations are distributed over forked R workers, 
+//'       e.g., by using `parallel::mclapply()`, build the mutation 
+//'       engine before forking: the workers inherit the engine data 
+//'       and the operating system shares its memory pages until they 
+//'       are modified. Workers that do not fork, e.g., PSOCK clusters, 
+//'       must build their own engines, which load the set-up files 
+//'       already saved in the set-up directory.
 //' @seealso `get_mutation_engine_codes` provides a list of the supported 
 //'         set-up codes.
 //' @export
@@ -704,6 +962,10 @@ RCPP_MODULE(Mutations){
 //'         (column "mutant"), the epistate (column "epistate"),
 //'         and the birth time (column "birth_time").
 //' }
+//' @field get_CNA_CCFs Gets the cancer cell fractions of the CNAs \itemize{
+//' \item \emph{Return:} A list containing the data frame of the CNAs and
+//'              the data frame of their per-sample cancer cell fractions.
+//' }
 //' @field get_first_occurrences Gets the identifier of the cell in which a 
 //'        mutation occurs for the first time\itemize{
 //' \item \emph{Parameter:} \code{mutation} - A mutation being either a 
@@ -711,7 +973,22 @@ RCPP_MODULE(Mutations){
 //' \item \emph{Return:} The identifier of the cell in which a mutation 
 //'              occurs for the first time
 //' }
+//' @field get_SNV_carriers Gets the sampled cells carrying some SNVs \itemize{
+//' \item \emph{Parameter:} \code{chromosome} - The vector of the SNV chromosome names.
+//' \item \emph{Parameter:} \code{chr_pos} - The vector of the SNV positions.
+//' \item \emph{Parameter:} \code{alt} - The vector of the SNV alternative bases.
+//' \item \emph{Return:} A data frame reporting the query index and the
+//'              identifier of each carrying cell.
+//' }
+//' @field get_SNV_CCFs Gets the cancer cell fractions of the SNVs \itemize{
+//' \item \emph{Return:} A list containing the data frame of the SNVs and
+//'              the data frame of their per-sample cancer cell fractions.
+//' }
 //' @field get_nodes Get the forest nodes \itemize{
+//' \item \emph{Parameter:} \code{compact} - A Boolean flag to produce factor
+//'              columns and ancestor row indices (optional).
+//' \item \emph{Parameter:} \code{skeleton} - A Boolean flag to export only
+//'              the roots and the branching nodes (optional).
 //' \item \emph{Return:} A data frame representing, for each node
 //'              in the forest, the identified (column "id"),
 //'              whenever the node is not a root, the ancestor
@@ -722,6 +999,11 @@ RCPP_MODULE(Mutations){
 //'              "mutant"), the epistate (column "epistate"),
 //'              and the birth time (column "birth_time").
 //' }
+//' @field get_sampled_cell_CNA_incidence Gets the deduplicated CNAs of the sampled cells \itemize{
+//' \item \emph{Parameter:} \code{num_threads} - The number of threads (optional).
+//' \item \emph{Returns:} A list containing the data frame of the distinct CNAs and
+//'          the cell-CNA incidence matrix in CSR format.
+//' }
 //' @field get_sampled_cell_CNAs Gets a the CNAs of the sampled cells \itemize{
 //' \item \emph{Returns:} A data frame reporting `cell_id`, `type` (`"A"` for 
 //'          amplifications and `"D"` for deletions), `chromosome`, `begin`
@@ -729,6 +1011,11 @@ RCPP_MODULE(Mutations){
 //'          last CNA locus in the chromosome), `allele`, and `src allele` 
 //'          (the allele origin for amplifications, `NA` for deletions).
 //' }
+//' @field get_sampled_cell_SNV_incidence Gets the deduplicated SNVs of the sampled cells \itemize{
+//' \item \emph{Parameter:} \code{num_threads} - The number of threads (optional).
+//' \item \emph{Returns:} A list containing the data frame of the distinct SNVs and
+//'          the cell-SNV incidence matrix in CSR format.
+//' }
 //' @field get_sampled_cell_SNVs Gets a the SNVs of the sampled cells \itemize{
 //' \item \emph{Returns:} A data frame reporting `cell_id`, `chromosome`, 
 //'          `chr_pos` (i.e., position in the chromosome), `allele` (in which
@@ -760,6 +1047,13 @@ RCPP_MODULE(Mutations){
 
 //' @name PhylogeneticForest$get_nodes
 //' @title Get the nodes of the forest
+//' @param compact A Boolean flag to encode the columns "mutant", "epistate",
+//'         and "sample" as factors and to add the column "ancestor_index"
+//'         reporting the row of the ancestor in the data frame (optional).
+//' @param skeleton A Boolean flag to export only the roots and the nodes
+//'         having at least two children, i.e., the coalescent skeleton
+//'         of the forest. When it is set, the column "ancestor" reports
+//'         the nearest ancestor in the skeleton (optional).
 //' @return A data frame representing, for each node
 //'         in the forest, the identified (column "cell_id"),
 //'         whenever the node is not a root, the ancestor
@@ -772,6 +1066,10 @@ RCPP_MODULE(Mutations){
 //' @seealso `SamplesForest$get_nodes` for usage examples
     .method("get_nodes", (List (PhylogeneticForest::*)() const)(&PhylogeneticForest::get_nodes),
             "Get the nodes of the forest")
+    .method("get_nodes", (List (PhylogeneticForest::*)(const bool&) const)(&PhylogeneticForest::get_nodes),
+            "Get the nodes of the forest")
+    .method("get_nodes", (List (PhylogeneticForest::*)(const bool&, const bool&) const)(&PhylogeneticForest::get_nodes),
+            "Get the nodes of the forest")
 
 //' @name PhylogeneticForest$get_coalescent_cells
 //' @title Retrieve most recent common ancestors
@@ -834,6 +1132,9 @@ RCPP_MODULE(Mutations){
 //' @description This method returns a data frame representing all the CNAs 
 //'          in the cells sampled during the simulation and represented by 
 //'          the leaves of the phylogenetic forest.
+//'          The CNAs inherited from a common ancestor are reported once per
+//'          sampled cell (see 
+//'          `PhylogeneticForest$get_sampled_cell_CNA_incidence()`).
 //' @param cell_id The identifier of the cell whose CNAs are aimed (optional).
 //' @return A data frame reporting `cell_id`, `type` (`"A"` for amplifications
 //'          and `"D"` for deletions), `chromosome`, `begin` (i.e., the first
@@ -855,6 +1156,13 @@ RCPP_MODULE(Mutations){
 //'          the leaves of the phylogenetic forest.
 //'          The data frame also reports the allele in which SNVs occur to 
 //'          support double occurrencies due to CNAs.
+//'          The SNVs inherited from a common ancestor are reported once per
+//'          sampled cell: when the forest has many leaves, the method
+//'          `PhylogeneticForest$get_sampled_cell_SNV_incidence()` reports 
+//'          each distinct SNV once and it requires much less memory. The
+//'          two methods report the same SNVs for each cell, but the
+//'          incidence matrix has no `allele` column: an SNV occurring in
+//'          many alleles of a cell is reported once.
 //' @param cell_id The identifier of the cell whose SNVs are aimed (optional).
 //' @return A data frame reporting `cell_id`, `chromosome`, `chr_pos` (i.e., 
 //'          the position in the chromosome), `allele` (in which the SNV
@@ -868,6 +1176,61 @@ RCPP_MODULE(Mutations){
                 (&PhylogeneticForest::get_sampled_cell_SNVs),
             "Get the SNVs of all the sampled cells")
 
+//' @name PhylogeneticForest$get_sampled_cell_CNA_incidence
+//' @title Gets the deduplicated CNAs of the sampled cells
+//' @description This method returns the CNAs in the cells represented by
+//'          the leaves of the phylogenetic forest as a table of distinct
+//'          CNAs and a sparse cell-CNA incidence matrix in compressed
+//'          sparse row (CSR) format. Differently from
+//'          `PhylogeneticForest$get_sampled_cell_CNAs()`, the CNAs shared
+//'          by many cells are reported once. The row of each cell lists
+//'          the distinct CNAs in the cell genome.
+//' @param num_threads The number of threads (default: 1).
+//' @return A list containing the data frame `mutations`, which reports
+//'          `type`, `chromosome`, `begin`, `end`, `allele`, and
+//'          `src allele` for each distinct CNA, the vector `cell_ids` of
+//'          the leaf identifiers, and the vectors `row_pointers` and
+//'          `mutation_indices`. The CNAs of the `i`-th cell in `cell_ids`
+//'          are the rows of `mutations` whose indices are in
+//'          `mutation_indices[(row_pointers[i]+1):row_pointers[i+1]]`.
+//' @seealso `vignette("mutations")` for usage examples
+    .method("get_sampled_cell_CNA_incidence", (List (PhylogeneticForest::*)(const int&) const)
+                (&PhylogeneticForest::get_sampled_cell_CNA_incidence),
+            "Get the deduplicated CNAs of all the sampled cells")
+    .method("get_sampled_cell_CNA_incidence", (List (PhylogeneticForest::*)() const)
+                (&PhylogeneticForest::get_sampled_cell_CNA_incidence),
+            "Get the deduplicated CNAs of all the sampled cells")
+
+//' @name PhylogeneticForest$get_sampled_cell_SNV_incidence
+//' @title Gets the deduplicated SNVs of the sampled cells
+//' @description This method returns the SNVs in the cells represented by
+//'          the leaves of the phylogenetic forest as a table of distinct
+//'          SNVs and a sparse cell-SNV incidence matrix in compressed
+//'          sparse row (CSR) format. Differently from
+//'          `PhylogeneticForest$get_sampled_cell_SNVs()`, the SNVs shared
+//'          by many cells are reported once and independently from the
+//'          alleles in which they occur. The row of each cell lists the
+//'          distinct SNVs in the cell genome: an SNV inherited from an
+//'          ancestor, but later removed by a deletion, is not reported.
+//' @param num_threads The number of threads (default: 1).
+//' @return A list containing the data frame `mutations`, which reports
+//'          `chromosome`, `chr_pos`, `ref`, `alt`, and `cause`
+//'          for each distinct SNV, the vector `cell_ids` of the leaf
+//'          identifiers, and the vectors `row_pointers` and
+//'          `mutation_indices`. The SNVs of the `i`-th cell in `cell_ids`
+//'          are the rows of `mutations` whose indices are in
+//'          `mutation_indices[(row_pointers[i]+1):row_pointers[i+1]]`.
+//'          The incidence matrix can be built by
+//'          `Matrix::sparseMatrix(j = mutation_indices, p = row_pointers,
+//'          repr = "R")`.
+//' @seealso `vignette("mutations")` for usage examples
+    .method("get_sampled_cell_SNV_incidence", (List (PhylogeneticForest::*)(const int&) const)
+                (&PhylogeneticForest::get_sampled_cell_SNV_incidence),
+            "Get the deduplicated SNVs of all the sampled cells")
+    .method("get_sampled_cell_SNV_incidence", (List (PhylogeneticForest::*)() const)
+                (&PhylogeneticForest::get_sampled_cell_SNV_incidence),
+            "Get the deduplicated SNVs of all the sampled cells")
+
 //' @name PhylogeneticForest$get_exposures
 //' @title Gets the timed exposure data frame
 //' @description This method returns a data frame representing the exposure 
@@ -887,6 +1250,54 @@ RCPP_MODULE(Mutations){
                 (&PhylogeneticForest::get_first_occurrence),
             "Get the identifier of the cell in which the mutation occurs for the first time")
 
+//' @name PhylogeneticForest$get_SNV_carriers
+//' @title Gets the sampled cells carrying some SNVs
+//' @description This method finds the forest leaves whose genomes
+//'          contain some SNVs. Only the leaves descending from the cells
+//'          in which the SNVs occur for the first time are tested: they
+//'          are retrieved from an index of the forest built once per
+//'          forest.
+//' @param chromosome The vector of the SNV chromosome names.
+//' @param chr_pos The vector of the SNV positions in the chromosomes.
+//' @param alt The vector of the SNV alternative bases.
+//' @return A data frame reporting `query`, i.e., the position of the SNV
+//'          in the parameter vectors, and `cell_id` for each sampled cell
+//'          carrying one of the SNVs.
+//' @seealso `vignette("mutations")` for usage examples
+    .method("get_SNV_carriers", &PhylogeneticForest::get_SNV_carriers,
+            "Get the sampled cells carrying some SNVs")
+
+//' @name PhylogeneticForest$get_SNV_CCFs
+//' @title Gets the cancer cell fractions of the SNVs
+//' @description This method computes, for each SNV occurring in the forest
+//'          and for each sample, the number of sample cells carrying the SNV
+//'          and the corresponding cancer cell fraction (CCF). The carriers
+//'          of a SNV are the leaves descending from its first occurrences
+//'          whose genomes still contain the SNV.
+//' @return A list containing the data frame `mutations`, which reports
+//'          `chromosome`, `chr_pos`, `ref`, `alt`, and `cause` of each SNV,
+//'          and the data frame `CCFs`, which reports `mutation_id`, i.e., the
+//'          row of the SNV in `mutations`, `sample`, `carriers`, and `CCF`.
+//' @seealso `vignette("mutations")` for usage examples
+    .method("get_SNV_CCFs", &PhylogeneticForest::get_SNV_CCFs,
+            "Get the cancer cell fractions of the SNVs")
+
+//' @name PhylogeneticForest$get_CNA_CCFs
+//' @title Gets the cancer cell fractions of the CNAs
+//' @description This method computes, for each CNA occurring in the forest
+//'          and for each sample, the number of sample cells carrying the CNA
+//'          and the corresponding cancer cell fraction (CCF). The carriers
+//'          of a CNA are the leaves descending from its first occurrences
+//'          whose genomes still contain the CNA.
+//' @return A list containing the data frame `mutations`, which reports
+//'          `type`, `chromosome`, `begin`, `end`, `allele`, and `src allele`
+//'          of each CNA, and the data frame `CCFs`, which reports
+//'          `mutation_id`, i.e., the row of the CNA in `mutations`, `sample`,
+//'          `carriers`, and `CCF`.
+//' @seealso `vignette("mutations")` for usage examples
+    .method("get_CNA_CCFs", &PhylogeneticForest::get_CNA_CCFs,
+            "Get the cancer cell fractions of the CNAs")
+
 //' @name PhylogeneticForest$save
 //' @title Save a phylogenetic forest in a file
 //' @param filename The path of the file in which the phylogenetic 
@@ -902,7 +1313,15 @@ RCPP_MODULE(Mutations){
 //' @title Load a phylogenetic forest from a file
 //' @param filename The path of the file from which the phylogenetic 
 //'            forest must be load.
+//' @param samples The names of the samples whose cells must be the
+//'            leaves of the loaded forest. When it is `NULL`, the
+//'            whole forest is loaded (default: `NULL`). This is a 
+//'            convenience for `load_phylogenetic_forest(filename)$get_subforest_for(samples)`:
+//'            the whole forest is read from the file anyway, so the
+//'            peak memory is not reduced.
 //' @return The load phylogenetic forest
-  function("load_phylogenetic_forest", &PhylogeneticForest::load,
+  function("load_phylogenetic_forest",
+           (PhylogeneticForest (*)(const std::string&, const SEXP&))(&PhylogeneticForest::load),
+           List::create(_["filename"], _["samples"]=R_NilValue),
            "Recover a phylogenetic forest");
 }
@@ -0,0 +1,148 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RRACES_PARALLEL_TASKS__
+#define __RRACES_PARALLEL_TASKS__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Validate a number of threads provided by the user
+ *
+ * @param num_threads is the number of threads requested from R
+ * @return the number of worker threads to be used
+ */
+inline size_t validate_num_threads(const int& num_threads)
+{
+  if (num_threads < 1) {
+    throw std::domain_error("The number of threads must be a positive "
+                            "number.");
+  }
+
+  return static_cast<size_t>(num_threads);
+}
+
+/**
+ * @brief Derive the random seed of an independent task
+ *
+ * The returned seed exclusively depends on the global seed and the
+ * task identifier. Hence, the tasks produce the same outcome
+ * independently from the number of threads and the scheduling.
+ *
+ * @param seed is the global random seed
+ * @param task_id is the task identifier
+ * @return the random seed of the task `task_id`
+ */
+inline int derive_task_seed(const int& seed, const uint32_t& task_id)
+{
+  std::seed_seq seed_seq{static_cast<uint32_t>(seed), task_id};
+
+  std::array<uint32_t, 1> task_seed;
+  seed_seq.generate(task_seed.begin(), task_seed.end());
+
+  return static_cast<int>(task_seed[0] >> 1);
+}
+
+/**
+ * @brief Get a name suffix that is unique among threads and processes
+ *
+ * @return a random suffix for temporary file names
+ */
+inline std::string get_unique_suffix()
+{
+  std::random_device device;
+  std::ostringstream oss;
+
+  oss << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id())
+      << "_" << device() << device();
+
+  return oss.str();
+}
+
+/**
+ * @brief Execute a set of independent tasks on a pool of threads
+ *
+ * The tasks are identified by the indices in `[0, num_of_tasks)` and
+ * they are dynamically dispatched to the threads: any idle thread
+ * pick the next unprocessed task. The first exception raised by
+ * a task is re-thrown in the calling thread once all the threads
+ * have terminated.
+ *
+ * The tasks must not call the R API.
+ *
+ * @param num_of_tasks is the number of tasks
+ * @param num_threads is the maximum number of threads
+ * @param task is a callable object accepting a task index
+ */
+template<typename TASK>
+void run_in_parallel(const size_t num_of_tasks, const size_t num_threads, TASK task)
+{
+  const size_t num_workers = std::min(num_threads, num_of_tasks);
+
+  if (num_workers <= 1) {
+    for (size_t i=0; i<num_of_tasks; ++i) {
+      task(i);
+    }
+
+    return;
+  }
+
+  std::atomic<size_t> next_task{0};
+  std::atomic<bool> failed{false};
+  std::vector<std::exception_ptr> exceptions(num_workers);
+
+  auto worker = [&](const size_t worker_id) {
+    try {
+      size_t i;
+      while (!failed && (i = next_task++) < num_of_tasks) {
+        task(i);
+      }
+    } catch (...) {
+      exceptions[worker_id] = std::current_exception();
+      failed = true;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers);
+  for (size_t worker_id=0; worker_id<num_workers; ++worker_id) {
+    workers.emplace_back(worker, worker_id);
+  }
+
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  for (const auto& exception : exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+}
+
+#endif // __RRACES_PARALLEL_TASKS__
@@ -15,7 +15,11 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <tuple>
+#include <algorithm>
+
 #include "phylogenetic_forest.hpp"
+#include "parallel_tasks.hpp"
 
 PhylogeneticForest::PhylogeneticForest():
   Races::Mutations::PhylogeneticForest()
@@ -45,6 +49,10 @@ PhylogeneticForest PhylogeneticForest::get_subforest_for(const std::vector<std::
   return forest;
 }
 
+// The leaf genomes are owned by the RACES forest and each of them stores
+// a complete copy of the mutations inherited from its ancestors. The
+// functions below walk those copies; the incidence export avoids
+// replicating them in its output.
 size_t count_SNVs(const Races::Mutations::CellGenomeMutations& cell_mutations)
 {
   size_t counter{0};
@@ -244,6 +252,229 @@ Rcpp::List PhylogeneticForest::get_sampled_cell_CNAs(const Races::Mutants::CellI
                            _["allele"]=dst_alleles, _["src allele"]=src_alleles);
 }
 
+bool carries(const Races::Mutations::CellGenomeMutations& cell_mutations,
+             const Races::Mutations::SNV& snv)
+{
+  const auto& chromosomes = cell_mutations.get_chromosomes();
+
+  auto chr_it = chromosomes.find(snv.chr_id);
+  if (chr_it == chromosomes.end()) {
+    return false;
+  }
+
+  for (const auto& [allele_id, allele]: chr_it->second.get_alleles()) {
+    for (const auto& [fragment_pos, fragment]: allele.get_fragments()) {
+      const auto& fragment_SNVs = fragment.get_SNVs();
+
+      auto snv_it = fragment_SNVs.find(snv.position);
+      if (snv_it != fragment_SNVs.end() && snv_it->second.alt_base == snv.alt_base) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool carries(const Races::Mutations::CellGenomeMutations& cell_mutations,
+             const Races::Mutations::CopyNumberAlteration& CNA)
+{
+  const auto& chromosomes = cell_mutations.get_chromosomes();
+
+  auto chr_it = chromosomes.find(CNA.region.get_chromosome_id());
+  if (chr_it == chromosomes.end()) {
+    return false;
+  }
+
+  for (const auto& chr_CNA: chr_it->second.get_CNAs()) {
+    if (!(chr_CNA < CNA) && !(CNA < chr_CNA)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief The sampled cell mutations in compressed sparse row format
+ *
+ * The mutations shared by many leaves are stored once in `mutations`,
+ * while the `i`-th leaf in `cell_ids` carries the mutations whose
+ * indices are in `mutation_indices[row_pointers[i]:row_pointers[i+1]]`.
+ */
+template<typename MUTATION_TYPE>
+struct MutationIncidence
+{
+  std::vector<Races::Mutants::CellId> cell_ids;
+  std::vector<size_t> row_pointers;
+  std::vector<int> mutation_indices;
+
+  std::vector<const MUTATION_TYPE*> mutations;
+};
+
+template<typename MUTATION_TYPE>
+MutationIncidence<MUTATION_TYPE>
+build_incidence(const std::map<MUTATION_TYPE, std::set<Races::Mutants::CellId>>& mutation_first_cells,
+                const LeafIntervalIndex& index, const size_t& num_threads)
+{
+  using Interval = LeafIntervalIndex::Interval;
+
+  MutationIncidence<MUTATION_TYPE> incidence;
+
+  incidence.cell_ids = index.leaves;
+  incidence.mutations.reserve(mutation_first_cells.size());
+  for (const auto& [mutation, first_cells]: mutation_first_cells) {
+    incidence.mutations.push_back(&mutation);
+  }
+
+  // only the leaves descending from the cells in which a mutation 
+  // arose may carry it
+  std::vector<std::vector<Interval>> mutation_intervals(mutation_first_cells.size());
+  {
+    std::vector<const std::set<Races::Mutants::CellId>*> first_cells;
+    first_cells.reserve(mutation_first_cells.size());
+    for (const auto& [mutation, cell_ids]: mutation_first_cells) {
+      first_cells.push_back(&cell_ids);
+    }
+
+    run_in_parallel(first_cells.size(), num_threads, [&](const size_t i) {
+      mutation_intervals[i] = index.get_intervals(*(first_cells[i]));
+    });
+  }
+
+  // the leaves are split in blocks and each task handles the rows of 
+  // one block: the rows are sized by a first visit and filled by a 
+  // second one, so that no per-leaf buffer is ever allocated
+  const size_t num_of_leaves = index.leaves.size();
+  const size_t num_of_blocks = std::min(num_threads, std::max(num_of_leaves, size_t{1}));
+  const size_t block_size = (num_of_leaves+num_of_blocks-1)/num_of_blocks;
+
+  auto visit_block = [&](const size_t block, auto function) {
+    const size_t block_begin = block*block_size;
+    const size_t block_end = std::min(block_begin+block_size, num_of_leaves);
+
+    for (size_t m=0; m<mutation_intervals.size(); ++m) {
+      std::vector<Interval> block_intervals;
+      for (const auto& [begin, end]: mutation_intervals[m]) {
+        if (begin < block_end && block_begin < end) {
+          block_intervals.emplace_back(std::max(begin, block_begin), std::min(end, block_end));
+        }
+      }
+
+      index.for_each_carrier(*(incidence.mutations[m]), block_intervals,
+                             [&](const size_t& pos) { function(m, pos); });
+    }
+  };
+
+  std::vector<size_t> row_sizes(num_of_leaves, 0);
+  run_in_parallel(num_of_blocks, num_threads, [&](const size_t block) {
+    visit_block(block, [&](const size_t&, const size_t& pos) { ++row_sizes[pos]; });
+  });
+
+  incidence.row_pointers.resize(num_of_leaves+1);
+  incidence.row_pointers[0] = 0;
+  for (size_t i=0; i<num_of_leaves; ++i) {
+    incidence.row_pointers[i+1] = incidence.row_pointers[i] + row_sizes[i];
+  }
+
+  // since the mutations are visited in order, the rows are sorted
+  incidence.mutation_indices.resize(incidence.row_pointers.back());
+  run_in_parallel(num_of_blocks, num_threads, [&](const size_t block) {
+    const size_t block_begin = block*block_size;
+    const size_t block_end = std::min(block_begin+block_size, num_of_leaves);
+
+    std::vector<size_t> cursors(incidence.row_pointers.begin()+block_begin,
+                                incidence.row_pointers.begin()+block_end);
+
+    visit_block(block, [&](const size_t& m, const size_t& pos) {
+      // R indices are 1-based
+      incidence.mutation_indices[cursors[pos-block_begin]++] = static_cast<int>(m+1);
+    });
+  });
+
+  return incidence;
+}
+
+template<typename MUTATION_TYPE>
+Rcpp::List wrap_incidence(const MutationIncidence<MUTATION_TYPE>& incidence,
+                          const Rcpp::List& mutations)
+{
+  using namespace Rcpp;
+
+  IntegerVector cell_ids(incidence.cell_ids.begin(), incidence.cell_ids.end());
+  NumericVector row_pointers(incidence.row_pointers.begin(), incidence.row_pointers.end());
+  IntegerVector mutation_indices(incidence.mutation_indices.begin(),
+                                 incidence.mutation_indices.end());
+
+  return List::create(_["mutations"]=mutations, _["cell_ids"]=cell_ids,
+                      _["row_pointers"]=row_pointers,
+                      _["mutation_indices"]=mutation_indices);
+}
+
+Rcpp::List PhylogeneticForest::get_sampled_cell_SNV_incidence(const int& num_threads) const
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  const auto incidence = build_incidence(get_SNV_first_cells(), get_leaf_index(),
+                                         validate_num_threads(num_threads));
+
+  const size_t num_of_mutations = incidence.mutations.size();
+
+  IntegerVector chr_pos(num_of_mutations);
+  CharacterVector chr_names(num_of_mutations), ref_bases(num_of_mutations),
+                  alt_bases(num_of_mutations), causes(num_of_mutations);
+
+  for (size_t i=0; i<num_of_mutations; ++i) {
+    const auto& snv = *(incidence.mutations[i]);
+
+    chr_names[i] = GenomicPosition::chrtos(snv.chr_id);
+    chr_pos[i] = snv.position;
+    ref_bases[i] = std::string(1, snv.ref_base);
+    alt_bases[i] = std::string(1, snv.alt_base);
+    causes[i] = snv.cause;
+  }
+
+  return wrap_incidence(incidence,
+                        DataFrame::create(_["chromosome"]=chr_names,
+                                          _["chr_pos"]=chr_pos,
+                                          _["ref"]=ref_bases, _["alt"]=alt_bases,
+                                          _["cause"]=causes));
+}
+
+Rcpp::List PhylogeneticForest::get_sampled_cell_CNA_incidence(const int& num_threads) const
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  const auto incidence = build_incidence(get_CNA_first_cells(), get_leaf_index(),
+                                         validate_num_threads(num_threads));
+
+  const size_t num_of_mutations = incidence.mutations.size();
+
+  IntegerVector CNA_begins(num_of_mutations), CNA_ends(num_of_mutations),
+                src_alleles(num_of_mutations), dst_alleles(num_of_mutations);
+  CharacterVector chr_names(num_of_mutations), types(num_of_mutations);
+
+  for (size_t i=0; i<num_of_mutations; ++i) {
+    const auto& CNA = *(incidence.mutations[i]);
+    const bool is_amp = CNA.type == CopyNumberAlteration::Type::AMPLIFICATION;
+
+    chr_names[i] = GenomicPosition::chrtos(CNA.region.get_chromosome_id());
+    CNA_begins[i] = CNA.region.get_initial_position();
+    CNA_ends[i] = CNA.region.get_final_position();
+    dst_alleles[i] = CNA.dest;
+    src_alleles[i] = (is_amp? CNA.source: NA_INTEGER);
+    types[i] = (is_amp?"A":"D");
+  }
+
+  return wrap_incidence(incidence,
+                        DataFrame::create(_["type"]=types, _["chromosome"]=chr_names,
+                                          _["begin"]=CNA_begins, _["end"]=CNA_ends,
+                                          _["allele"]=dst_alleles,
+                                          _["src allele"]=src_alleles));
+}
+
 template<typename MUTATION_TYPE, typename R_MUTATION> 
 Rcpp::List get_first_occurrence(const std::map<MUTATION_TYPE, std::set<Races::Mutants::CellId>>& mutation_first_cells,
                                 const R_MUTATION& mutation)
@@ -295,6 +526,253 @@ Rcpp::List PhylogeneticForest::get_first_occurrence(const SEXP& mutation) const
              "SNV or CNA objects.");
 }
 
+template<typename CPP_FOREST>
+LeafIntervalIndex::LeafIntervalIndex(const CPP_FOREST& forest)
+{
+  using namespace Races::Mutants;
+
+  std::map<std::string, size_t> sample_indices;
+  for (const auto& sample: forest.get_samples()) {
+    sample_indices.emplace(sample.get_name(), sample_names.size());
+    sample_names.push_back(sample.get_name());
+  }
+
+  std::map<CellId, std::vector<CellId>> children;
+  std::vector<CellId> roots;
+  for (const auto& [cell_id, cell]: forest.get_cells()) {
+    auto node = forest.get_node(cell_id);
+    if (node.is_root()) {
+      roots.push_back(cell_id);
+    } else {
+      children[node.parent().get_id()].push_back(cell_id);
+    }
+  }
+
+  // visit the forest iteratively: lineages may be very deep
+  std::vector<std::pair<CellId, size_t>> stack;
+  for (const auto& root_id: roots) {
+    stack.emplace_back(root_id, 0);
+    intervals[root_id].first = leaves.size();
+
+    while (!stack.empty()) {
+      auto& [cell_id, child_pos] = stack.back();
+
+      auto children_it = children.find(cell_id);
+      if (children_it != children.end() && child_pos < children_it->second.size()) {
+        const auto child_id = children_it->second[child_pos++];
+
+        intervals[child_id].first = leaves.size();
+        stack.emplace_back(child_id, 0);
+      } else {
+        auto node = forest.get_node(cell_id);
+        if (node.is_leaf()) {
+          leaves.push_back(cell_id);
+          leaf_mutations.push_back(forest.get_leaves_mutations().at(cell_id).get());
+          leaf_samples.push_back(static_cast<uint32_t>(sample_indices.at(node.get_sample().get_name())));
+        }
+
+        intervals[cell_id].second = leaves.size();
+        stack.pop_back();
+      }
+    }
+  }
+
+  sample_sizes.resize(sample_names.size(), 0);
+  for (const auto& sample: leaf_samples) {
+    ++sample_sizes[sample];
+  }
+}
+
+std::vector<LeafIntervalIndex::Interval>
+LeafIntervalIndex::get_intervals(const std::set<Races::Mutants::CellId>& cell_ids) const
+{
+  std::vector<Interval> cell_intervals;
+  for (const auto& cell_id: cell_ids) {
+    auto found = intervals.find(cell_id);
+    if (found != intervals.end()) {
+      cell_intervals.push_back(found->second);
+    }
+  }
+
+  // merge nested and overlapping intervals
+  std::sort(cell_intervals.begin(), cell_intervals.end());
+
+  std::vector<Interval> merged;
+  for (const auto& interval: cell_intervals) {
+    if (!merged.empty() && interval.first <= merged.back().second) {
+      merged.back().second = std::max(merged.back().second, interval.second);
+    } else {
+      merged.push_back(interval);
+    }
+  }
+
+  return merged;
+}
+
+const LeafIntervalIndex& PhylogeneticForest::get_leaf_index() const
+{
+  if (!leaf_index) {
+    leaf_index = std::make_shared<const LeafIntervalIndex>(
+                    static_cast<const Races::Mutations::PhylogeneticForest&>(*this));
+  }
+
+  return *leaf_index;
+}
+
+Rcpp::List PhylogeneticForest::get_SNV_carriers(const std::vector<std::string>& chromosomes,
+                                                const std::vector<Races::Mutations::ChrPosition>& positions,
+                                                const std::vector<std::string>& alt_bases) const
+{
+  using namespace Races::Mutations;
+
+  if (chromosomes.size() != positions.size() || chromosomes.size() != alt_bases.size()) {
+    throw std::domain_error("The parameters \"chromosome\", \"chr_pos\", and \"alt\" "
+                            "must have the same length.");
+  }
+
+  using Key = std::tuple<ChromosomeId, ChrPosition, char>;
+
+  // the SNVs sharing a key only differ in their causes, so any of 
+  // them can be used to test the leaf genomes
+  std::map<Key, std::pair<const SNV*, std::set<Races::Mutants::CellId>>> SNV_first_cells;
+  for (const auto& [snv, first_cells]: get_SNV_first_cells()) {
+    auto& [representative, cells] = SNV_first_cells[{snv.chr_id, snv.position, snv.alt_base}];
+
+    representative = &snv;
+    cells.insert(first_cells.begin(), first_cells.end());
+  }
+
+  const auto& index = get_leaf_index();
+
+  std::vector<int> queries, cell_ids;
+  for (size_t i=0; i<chromosomes.size(); ++i) {
+    if (alt_bases[i].size()!=1) {
+      throw std::domain_error("The alternative base \""+alt_bases[i]
+                              +"\" must be a single nucleotide.");
+    }
+
+    auto found = SNV_first_cells.find({GenomicPosition::stochr(chromosomes[i]),
+                                       positions[i], alt_bases[i][0]});
+    if (found != SNV_first_cells.end()) {
+      const auto& [representative, first_cells] = found->second;
+
+      index.for_each_carrier(*representative, index.get_intervals(first_cells),
+                             [&](const size_t& pos) {
+        queries.push_back(static_cast<int>(i+1));
+        cell_ids.push_back(index.leaves[pos]);
+      });
+    }
+  }
+
+  using namespace Rcpp;
+
+  return DataFrame::create(_["query"]=wrap(queries), _["cell_id"]=wrap(cell_ids));
+}
+
+template<typename MUTATION_TYPE, typename COLUMN_FILLER>
+Rcpp::List get_CCF_table(const std::map<MUTATION_TYPE, std::set<Races::Mutants::CellId>>& mutation_first_cells,
+                         const LeafIntervalIndex& index, const Rcpp::List& columns,
+                         COLUMN_FILLER fill_columns)
+{
+  using namespace Rcpp;
+
+  const size_t num_of_samples = index.sample_names.size();
+  const size_t num_of_rows = mutation_first_cells.size()*num_of_samples;
+
+  const auto& sample_sizes = index.sample_sizes;
+
+  IntegerVector mutation_ids(num_of_rows), sample_ids(num_of_rows), carriers(num_of_rows);
+  NumericVector CCFs(num_of_rows);
+
+  size_t row{0}, mutation_id{0};
+  for (const auto& [mutation, first_cells]: mutation_first_cells) {
+    fill_columns(mutation_id, mutation);
+
+    std::vector<size_t> sample_carriers(num_of_samples, 0);
+    index.for_each_carrier(mutation, index.get_intervals(first_cells),
+                           [&](const size_t& pos) { ++sample_carriers[index.leaf_samples[pos]]; });
+
+    for (size_t sample=0; sample<num_of_samples; ++sample, ++row) {
+      const auto& num_of_carriers = sample_carriers[sample];
+
+      mutation_ids[row] = static_cast<int>(mutation_id+1);
+      sample_ids[row] = static_cast<int>(sample+1);
+      carriers[row] = static_cast<int>(num_of_carriers);
+      CCFs[row] = (sample_sizes[sample]>0?
+                   static_cast<double>(num_of_carriers)/sample_sizes[sample]: NA_REAL);
+    }
+    ++mutation_id;
+  }
+
+  CharacterVector levels(index.sample_names.begin(), index.sample_names.end());
+  sample_ids.attr("levels") = levels;
+  sample_ids.attr("class") = "factor";
+
+  return List::create(_["mutations"]=DataFrame(columns),
+                      _["CCFs"]=DataFrame::create(_["mutation_id"]=mutation_ids,
+                                                  _["sample"]=sample_ids,
+                                                  _["carriers"]=carriers,
+                                                  _["CCF"]=CCFs));
+}
+
+Rcpp::List PhylogeneticForest::get_SNV_CCFs() const
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  const size_t num_of_mutations = get_SNV_first_cells().size();
+
+  List columns = List::create(_["chromosome"]=CharacterVector(num_of_mutations),
+                              _["chr_pos"]=IntegerVector(num_of_mutations),
+                              _["ref"]=CharacterVector(num_of_mutations),
+                              _["alt"]=CharacterVector(num_of_mutations),
+                              _["cause"]=CharacterVector(num_of_mutations));
+
+  CharacterVector chr_names = columns["chromosome"], ref_bases = columns["ref"],
+                  alt_bases = columns["alt"], causes = columns["cause"];
+  IntegerVector chr_pos = columns["chr_pos"];
+
+  return get_CCF_table(get_SNV_first_cells(), get_leaf_index(), columns,
+                       [&](const size_t& i, const auto& snv) {
+    chr_names[i] = GenomicPosition::chrtos(snv.chr_id);
+    chr_pos[i] = snv.position;
+    ref_bases[i] = std::string(1, snv.ref_base);
+    alt_bases[i] = std::string(1, snv.alt_base);
+    causes[i] = snv.cause;
+  });
+}
+
+Rcpp::List PhylogeneticForest::get_CNA_CCFs() const
+{
+  using namespace Rcpp;
+  using namespace Races::Mutations;
+
+  const size_t num_of_mutations = get_CNA_first_cells().size();
+
+  List columns = List::create(_["type"]=CharacterVector(num_of_mutations),
+                              _["chromosome"]=CharacterVector(num_of_mutations),
+                              _["begin"]=IntegerVector(num_of_mutations),
+                              _["end"]=IntegerVector(num_of_mutations),
+                              _["allele"]=IntegerVector(num_of_mutations),
+                              _["src allele"]=IntegerVector(num_of_mutations));
+
+  CharacterVector types = columns["type"], chr_names = columns["chromosome"];
+  IntegerVector CNA_begins = columns["begin"], CNA_ends = columns["end"],
+                dst_alleles = columns["allele"], src_alleles = columns["src allele"];
+
+  return get_CCF_table(get_CNA_first_cells(), get_leaf_index(), columns,
+                       [&](const size_t& i, const auto& CNA) {
+    const bool is_amp = CNA.type == CopyNumberAlteration::Type::AMPLIFICATION;
+
+    types[i] = (is_amp?"A":"D");
+    chr_names[i] = GenomicPosition::chrtos(CNA.region.get_chromosome_id());
+    CNA_begins[i] = CNA.region.get_initial_position();
+    CNA_ends[i] = CNA.region.get_final_position();
+    dst_alleles[i] = CNA.dest;
+    src_alleles[i] = (is_amp? CNA.source: NA_INTEGER);
+  });
+}
+
 Rcpp::List PhylogeneticForest::get_timed_exposures() const
 {
   using namespace Rcpp;
@@ -355,6 +833,23 @@ PhylogeneticForest PhylogeneticForest::load(const std::string& filename)
   return forest;
 }
 
+PhylogeneticForest PhylogeneticForest::load(const std::string& filename, const SEXP& sample_names)
+{
+  if (Rf_isNull(sample_names)) {
+    return load(filename);
+  }
+
+  if (TYPEOF(sample_names) != STRSXP) {
+    throw std::domain_error("The parameter \"samples\" must be either NULL or "
+                            "a vector of sample names.");
+  }
+
+  const auto names = Rcpp::as<std::vector<std::string>>(sample_names);
+
+  // a convenience wrapper: the complete forest is loaded anyway
+  return load(filename).get_subforest_for(names);
+}
+
 void PhylogeneticForest::show() const
 {
   using namespace Rcpp;
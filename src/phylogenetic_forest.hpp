@@ -19,6 +19,9 @@
 #define __RRACES_PHYLOGENETIC_FOREST__
 
 #include <map>
+#include <cstdint>
+#include <set>
+#include <memory>
 #include <vector>
 
 #include <Rcpp.h>
@@ -32,12 +35,86 @@
 
 class MutationEngine;
 
+/**
+ * @brief Test whether a cell genome contains an SNV
+ *
+ * @param cell_mutations is the cell genome mutations
+ * @param snv is the SNV
+ * @return `true` if and only if one of the alleles of `cell_mutations`
+ *      contains `snv`
+ */
+bool carries(const Races::Mutations::CellGenomeMutations& cell_mutations,
+             const Races::Mutations::SNV& snv);
+
+/**
+ * @brief Test whether a cell genome contains a CNA
+ *
+ * @param cell_mutations is the cell genome mutations
+ * @param CNA is the CNA
+ * @return `true` if and only if `cell_mutations` contains `CNA`
+ */
+bool carries(const Races::Mutations::CellGenomeMutations& cell_mutations,
+             const Races::Mutations::CopyNumberAlteration& CNA);
+
+/**
+ * @brief An index of the forest leaves in depth-first order
+ *
+ * The leaves of any subtree are contiguous in a depth-first visit
+ * of the forest (Euler tour). Hence, the leaves descending from a
+ * node are represented by an interval of leaf positions. A mutation
+ * can only be carried by the leaves descending from the cells in which
+ * it arose, but a later deletion may remove it: the carriers are the 
+ * leaves in the intervals whose genomes still contain the mutation.
+ */
+struct LeafIntervalIndex
+{
+  using Interval = std::pair<size_t, size_t>;
+
+  std::vector<Races::Mutants::CellId> leaves;   //!< the leaves in depth-first order
+  std::vector<const Races::Mutations::CellGenomeMutations*> leaf_mutations;  //!< the leaf genomes
+  std::map<Races::Mutants::CellId, Interval> intervals;  //!< the leaf interval of each node
+
+  std::vector<std::string> sample_names;        //!< the sample names
+  std::vector<uint32_t> leaf_samples;           //!< the sample index of each leaf
+  std::vector<size_t> sample_sizes;             //!< the number of leaves of each sample
+
+  template<typename CPP_FOREST>
+  explicit LeafIntervalIndex(const CPP_FOREST& forest);
+
+  std::vector<Interval> get_intervals(const std::set<Races::Mutants::CellId>& cell_ids) const;
+
+  /**
+   * @brief Apply a function to the positions of the leaves carrying a mutation
+   *
+   * @param mutation is the mutation
+   * @param intervals are the leaf intervals of the cells in which `mutation` arose
+   * @param function is a function accepting a leaf position
+   */
+  template<typename MUTATION_TYPE, typename FUNCTION>
+  void for_each_carrier(const MUTATION_TYPE& mutation, const std::vector<Interval>& intervals,
+                        FUNCTION function) const
+  {
+    for (const auto& [begin, end]: intervals) {
+      for (size_t pos=begin; pos<end; ++pos) {
+        if (carries(*(leaf_mutations[pos]), mutation)) {
+          function(pos);
+        }
+      }
+    }
+  }
+};
+
 class PhylogeneticForest : public Races::Mutations::PhylogeneticForest
 {
   std::filesystem::path reference_path;
 
   std::map<Races::Time, Races::Mutations::Exposure> timed_exposures;
 
+  //! The leaf index (built on demand)
+  mutable std::shared_ptr<const LeafIntervalIndex> leaf_index;
+
+  const LeafIntervalIndex& get_leaf_index() const;
+
   PhylogeneticForest(const Races::Mutations::PhylogeneticForest& orig, 
                      const std::filesystem::path& reference_path,
                      const std::map<Races::Time, Races::Mutations::Exposure>& timed_exposures);
@@ -53,6 +130,17 @@ public:
     return ForestCore::get_nodes(static_cast<const Races::Mutations::PhylogeneticForest&>(*this));
   }
 
+  inline Rcpp::List get_nodes(const bool& compact) const
+  {
+    return get_nodes(compact, false);
+  }
+
+  inline Rcpp::List get_nodes(const bool& compact, const bool& skeleton) const
+  {
+    return ForestCore::get_nodes(static_cast<const Races::Mutations::PhylogeneticForest&>(*this),
+                                 compact, skeleton);
+  }
+
   inline Rcpp::List get_samples_info() const
   {
     return ForestCore::get_samples_info(static_cast<const Races::Mutations::PhylogeneticForest&>(*this));
@@ -84,8 +172,30 @@ public:
 
   Rcpp::List get_sampled_cell_CNAs(const Races::Mutants::CellId& cell_ids) const;
 
+  Rcpp::List get_sampled_cell_SNV_incidence(const int& num_threads) const;
+
+  inline Rcpp::List get_sampled_cell_SNV_incidence() const
+  {
+    return get_sampled_cell_SNV_incidence(1);
+  }
+
+  Rcpp::List get_sampled_cell_CNA_incidence(const int& num_threads) const;
+
+  inline Rcpp::List get_sampled_cell_CNA_incidence() const
+  {
+    return get_sampled_cell_CNA_incidence(1);
+  }
+
   Rcpp::List get_first_occurrence(const SEXP& mutation) const;
 
+  Rcpp::List get_SNV_carriers(const std::vector<std::string>& chromosomes,
+                              const std::vector<Races::Mutations::ChrPosition>& positions,
+                              const std::vector<std::string>& alt_bases) const;
+
+  Rcpp::List get_SNV_CCFs() const;
+
+  Rcpp::List get_CNA_CCFs() const;
+
   Rcpp::List get_timed_exposures() const;
 
   inline std::filesystem::path get_reference_path() const
@@ -97,6 +207,8 @@ public:
 
   static PhylogeneticForest load(const std::string& filename);
 
+  static PhylogeneticForest load(const std::string& filename, const SEXP& sample_names);
+
   void show() const;
 
   friend class MutationEngine;
@@ -0,0 +1,130 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.hpp"
+
+Profiler::ScopedTimer::ScopedTimer(Profiler* profiler, const std::string& phase):
+  profiler(profiler)
+{
+  if (profiler != nullptr) {
+    this->phase = phase;
+    begin = std::chrono::steady_clock::now();
+  }
+}
+
+Profiler::ScopedTimer::~ScopedTimer()
+{
+  if (profiler != nullptr) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    profiler->add_time(phase, elapsed.count());
+  }
+}
+
+Profiler::Profiler(const Profiler& orig)
+{
+  std::lock_guard<std::mutex> lock(orig.mutex);
+
+  phases = orig.phases;
+  counters = orig.counters;
+}
+
+void Profiler::add_time(const std::string& phase, const double& seconds)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto& phase_data = phases[phase];
+
+  ++phase_data.calls;
+  phase_data.seconds += seconds;
+}
+
+void Profiler::add(Profiler* profiler, const std::string& counter,
+                   const double& value, const std::string& phase)
+{
+  if (profiler == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(profiler->mutex);
+
+  auto& counter_data = profiler->counters[counter];
+
+  ++counter_data.updates;
+  counter_data.value += value;
+  counter_data.phase = phase;
+}
+
+void Profiler::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  phases.clear();
+  counters.clear();
+}
+
+Rcpp::List Profiler::get_dataframe() const
+{
+  using namespace Rcpp;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  const size_t num_of_rows = phases.size()+counters.size();
+
+  CharacterVector names(num_of_rows), types(num_of_rows);
+  IntegerVector calls(num_of_rows);
+  NumericVector values(num_of_rows), rates(num_of_rows);
+
+  size_t i{0};
+  for (const auto& [name, phase]: phases) {
+    names[i] = name;
+    types[i] = "timer";
+    calls[i] = static_cast<int>(phase.calls);
+    values[i] = phase.seconds;
+    rates[i] = NA_REAL;
+
+    ++i;
+  }
+
+  for (const auto& [name, counter]: counters) {
+    names[i] = name;
+    types[i] = "counter";
+    calls[i] = static_cast<int>(counter.updates);
+    values[i] = counter.value;
+
+    auto phase_it = phases.find(counter.phase);
+    if (phase_it != phases.end() && phase_it->second.seconds > 0) {
+      rates[i] = counter.value/phase_it->second.seconds;
+    } else {
+      rates[i] = NA_REAL;
+    }
+
+    ++i;
+  }
+
+  return DataFrame::create(_["name"]=names, _["type"]=types, _["calls"]=calls,
+                           _["value"]=values, _["rate"]=rates);
+}
+
+Rcpp::List Profiler::get_dataframe(const Profiler* profiler)
+{
+  if (profiler == nullptr) {
+    return Profiler().get_dataframe();
+  }
+
+  return profiler->get_dataframe();
+}
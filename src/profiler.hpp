@@ -0,0 +1,133 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RRACES_PROFILER__
+#define __RRACES_PROFILER__
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+
+#include <Rcpp.h>
+
+/**
+ * @brief A collector of phase timings and counters
+ *
+ * Objects supporting profiling hold a pointer to a profiler, which is
+ * null when profiling is disabled. The timers and the counters accept
+ * null pointers and, in such a case, they do nothing. Hence, disabled
+ * profiling costs a pointer test per instrumented scope.
+ *
+ * Profilers can be safely updated by many threads.
+ */
+class Profiler
+{
+  struct Phase
+  {
+    size_t calls{0};     //!< the number of timed scopes
+    double seconds{0};   //!< the total time spent in the phase
+  };
+
+  struct Counter
+  {
+    size_t updates{0};   //!< the number of updates
+    double value{0};     //!< the counter value
+    std::string phase;   //!< the phase used to compute the counter rate
+  };
+
+  mutable std::mutex mutex;
+
+  std::map<std::string, Phase> phases;      //!< the phase timings
+  std::map<std::string, Counter> counters;  //!< the counters
+public:
+  /**
+   * @brief A timer measuring the lifetime of a scope
+   */
+  class ScopedTimer
+  {
+    Profiler* profiler;
+    std::string phase;
+    std::chrono::steady_clock::time_point begin;
+  public:
+    ScopedTimer(Profiler* profiler, const std::string& phase);
+
+    ScopedTimer(const ScopedTimer&) = delete;
+
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer();
+  };
+
+  /**
+   * @brief The empty constructor
+   */
+  Profiler() = default;
+
+  /**
+   * @brief The copy constructor
+   *
+   * @param orig is the template profiler
+   */
+  Profiler(const Profiler& orig);
+
+  /**
+   * @brief Add a time measure to a phase
+   *
+   * @param phase is the phase name
+   * @param seconds is the time to be added
+   */
+  void add_time(const std::string& phase, const double& seconds);
+
+  /**
+   * @brief Increase a counter
+   *
+   * @param profiler is a pointer to the profiler (null when disabled)
+   * @param counter is the counter name
+   * @param value is the value to be added to the counter
+   * @param phase is the phase whose time is used to compute the counter
+   *      rate (e.g., the events per second)
+   */
+  static void add(Profiler* profiler, const std::string& counter,
+                  const double& value, const std::string& phase="");
+
+  /**
+   * @brief Reset all the timings and counters
+   */
+  void reset();
+
+  /**
+   * @brief Get the profile data frame
+   *
+   * @return a data frame reporting "name", "type" (either "timer"
+   *      or "counter"), "calls", "value" (seconds for timers), and
+   *      "rate" (value per second of the associated phase) for each
+   *      timer and counter
+   */
+  Rcpp::List get_dataframe() const;
+
+  /**
+   * @brief Get the profile data frame of a possibly disabled profiler
+   *
+   * @param profiler is a pointer to the profiler (null when disabled)
+   * @return the profile data frame of `profiler` if it is not null,
+   *      an empty data frame otherwise
+   */
+  static Rcpp::List get_dataframe(const Profiler* profiler);
+};
+
+#endif // __RRACES_PROFILER__
@@ -0,0 +1,197 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+#include <read_simulator.hpp>
+
+#include "reference_cache.hpp"
+#include "parallel_tasks.hpp"
+
+void split_reference_by_chromosome(const std::filesystem::path& reference_path,
+                                   const std::filesystem::path& directory)
+{
+  using namespace Races::Mutations;
+
+  std::filesystem::create_directory(directory);
+
+  std::ifstream reference_stream(reference_path);
+  if (!reference_stream.good()) {
+    throw std::runtime_error("Cannot read the reference genome file \""
+                             + reference_path.string() + "\".");
+  }
+
+  std::ofstream chr_stream;
+  std::filesystem::path chr_path;
+
+  auto close_chr_stream = [&chr_stream, &chr_path]() {
+    if (chr_stream.is_open()) {
+      chr_stream.close();
+      if (chr_stream.fail()) {
+        throw std::runtime_error("Cannot write the file \"" + chr_path.string() + "\".");
+      }
+    }
+  };
+
+  std::string line;
+  while (std::getline(reference_stream, line)) {
+    if (line.size()>0 && line[0]=='>') {
+      close_chr_stream();
+
+      ChromosomeId chr_id;
+      if (Races::IO::FASTA::is_chromosome_header(line.substr(1), chr_id)) {
+        chr_path = directory/("chr_" + GenomicPosition::chrtos(chr_id) + ".fasta");
+        chr_stream.open(chr_path);
+        if (!chr_stream.good()) {
+          throw std::runtime_error("Cannot create the file \"" + chr_path.string() + "\".");
+        }
+      }
+    }
+
+    if (chr_stream.is_open()) {
+      chr_stream << line << '\n';
+      if (!chr_stream.good()) {
+        throw std::runtime_error("Cannot write the file \"" + chr_path.string() + "\".");
+      }
+    }
+  }
+
+  if (reference_stream.bad()) {
+    throw std::runtime_error("Error while reading the reference genome file \""
+                             + reference_path.string() + "\".");
+  }
+
+  close_chr_stream();
+}
+
+/**
+ * @brief Build the per-chromosome reference cache in a directory
+ *
+ * The split is performed in a temporary directory which is then renamed
+ * into `directory`, so that concurrent processes never observe partial
+ * caches.
+ *
+ * @param reference_path is the path of the reference genome FASTA file
+ * @param directory is the cache directory
+ */
+void build_chromosome_cache(const std::filesystem::path& reference_path,
+                            const std::filesystem::path& directory)
+{
+  auto tmp_directory = directory;
+  tmp_directory += "_tmp_" + get_unique_suffix();
+
+  try {
+    split_reference_by_chromosome(reference_path, tmp_directory);
+  } catch (...) {
+    std::error_code error;
+    std::filesystem::remove_all(tmp_directory, error);
+
+    throw;
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tmp_directory, directory, error);
+  if (error) {
+    // another process has concurrently built the directory
+    std::filesystem::remove_all(tmp_directory, error);
+  }
+}
+
+/**
+ * @brief Remove the caches of previous versions of the reference
+ *
+ * @param directory is the cache directory of the current reference
+ * @param cache_prefix is the name prefix of all the reference caches
+ */
+void remove_stale_caches(const std::filesystem::path& directory,
+                         const std::string& cache_prefix)
+{
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(directory.parent_path(), error)) {
+    const auto filename = entry.path().filename().string();
+
+    if (entry.is_directory(error) && entry.path() != directory
+        && filename.rfind(cache_prefix, 0)==0
+        && filename.size()>5 && filename.substr(filename.size()-5) == ".chrs") {
+      std::filesystem::remove_all(entry.path(), error);
+    }
+  }
+}
+
+std::map<Races::Mutations::ChromosomeId, std::filesystem::path>
+get_chromosome_references(const std::filesystem::path& reference_path)
+{
+  using namespace Races::Mutations;
+  namespace fs = std::filesystem;
+
+  if (!fs::exists(reference_path)) {
+    throw std::runtime_error("The reference genome file \"" + reference_path.string()
+                             + "\" does not exist.");
+  }
+
+  // the cache is keyed on the reference size and last modification 
+  // time, so that it is rebuilt whenever the reference changes
+  const auto ref_time = fs::last_write_time(reference_path).time_since_epoch().count();
+  const auto cache_prefix = reference_path.filename().string() + ".";
+  const auto cache_name = cache_prefix + std::to_string(fs::file_size(reference_path))
+                            + "-" + std::to_string(ref_time) + ".chrs";
+
+  // the per-chromosome references are stored side by side with the 
+  // reference genome or, when its directory is not writable, in the 
+  // temporary directory
+  auto directory = reference_path.parent_path()/cache_name;
+  if (!fs::exists(directory)) {
+    try {
+      build_chromosome_cache(reference_path, directory);
+      remove_stale_caches(directory, cache_prefix);
+    } catch (std::runtime_error&) {
+      // both the file system errors and the write errors of the split 
+      // end up here: build_chromosome_cache() has already removed the
+      // partial split directory
+      std::error_code error;
+      if (fs::exists(directory, error) && fs::is_empty(directory, error)) {
+        fs::remove(directory, error);
+      }
+
+      const auto abs_path = fs::absolute(reference_path).string();
+      const auto tmp_cache_path = fs::temp_directory_path()/"rRACES_references"
+                                    /std::to_string(std::hash<std::string>()(abs_path));
+
+      fs::create_directories(tmp_cache_path);
+
+      directory = tmp_cache_path/cache_name;
+      if (!fs::exists(directory)) {
+        build_chromosome_cache(reference_path, directory);
+        remove_stale_caches(directory, cache_prefix);
+      }
+    }
+  }
+
+  std::map<ChromosomeId, fs::path> chr_references;
+  for (const auto& entry : fs::directory_iterator(directory)) {
+    const auto filename = entry.path().stem().string();
+
+    if (filename.rfind("chr_", 0)==0) {
+      chr_references[GenomicPosition::stochr(filename.substr(4))] = entry.path();
+    }
+  }
+
+  return chr_references;
+}
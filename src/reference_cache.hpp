@@ -0,0 +1,47 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RRACES_REFERENCE_CACHE__
+#define __RRACES_REFERENCE_CACHE__
+
+#include <map>
+#include <filesystem>
+
+#include <snv.hpp>
+
+/**
+ * @brief Get the per-chromosome references of a reference genome
+ *
+ * The reference genome FASTA file is split once into per-chromosome
+ * FASTA files, which are stored in the directory 
+ * `<reference>.<size>-<time>.chrs` side by side with the reference 
+ * itself and re-used by successive calls. The directory name depends
+ * on the size and the last modification time of the reference, so 
+ * that the cache is rebuilt whenever the reference changes. If the 
+ * reference directory is not writable, the cache is stored in the
+ * system temporary directory. The split is performed in a uniquely 
+ * named temporary directory and then renamed, so concurrent processes 
+ * never observe partial caches.
+ *
+ * @param reference_path is the path of the reference genome FASTA file
+ * @return a map associating the identifier of every chromosome in the
+ *      reference to the path of its FASTA file
+ */
+std::map<Races::Mutations::ChromosomeId, std::filesystem::path>
+get_chromosome_references(const std::filesystem::path& reference_path);
+
+#endif // __RRACES_REFERENCE_CACHE__
@@ -42,6 +42,17 @@ public:
     return ForestCore::get_nodes(static_cast<const Races::Mutants::DescendantsForest&>(*this));
   }
 
+  inline Rcpp::List get_nodes(const bool& compact) const
+  {
+    return get_nodes(compact, false);
+  }
+
+  inline Rcpp::List get_nodes(const bool& compact, const bool& skeleton) const
+  {
+    return ForestCore::get_nodes(static_cast<const Races::Mutants::DescendantsForest&>(*this),
+                                 compact, skeleton);
+  }
+
   inline Rcpp::List get_samples_info() const
   {
     return ForestCore::get_samples_info(static_cast<const Races::Mutants::DescendantsForest&>(*this));
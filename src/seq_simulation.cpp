@@ -17,118 +17,393 @@
 
 #include "seq_simulation.hpp"
 
-void add_SNV_data(Rcpp::DataFrame& df,
-                  const Races::Mutations::SequencingSimulations::SampleStatistics& sample_statistics)
+SequencingRegions::SequencingRegions():
+  whole_genome(true), intervals()
+{}
+
+SequencingRegions::SequencingRegions(const SEXP& regions):
+  whole_genome(Rf_isNull(regions)), intervals()
 {
   using namespace Rcpp;
   using namespace Races::Mutations;
 
-  size_t num_of_mutations = sample_statistics.get_SNV_occurrences().size();
+  if (whole_genome) {
+    return;
+  }
 
-  IntegerVector chr_pos(num_of_mutations);
-  CharacterVector chr_names(num_of_mutations), ref_bases(num_of_mutations),
-                  alt_bases(num_of_mutations);
+  if (Rf_isString(regions)) {
+    for (const auto& chr_name: as<std::vector<std::string>>(regions)) {
+      intervals[GenomicPosition::stochr(chr_name)];
+    }
 
-  size_t index{0};
-  for (const auto& [snv, occurrences] : sample_statistics.get_SNV_occurrences()) {
-    chr_names[index] = GenomicPosition::chrtos(snv.chr_id);
-    chr_pos[index] = snv.position;
-    ref_bases[index] = std::string(1,snv.ref_base);
-    alt_bases[index] = std::string(1,snv.alt_base);
-  
-    ++index;
-  }
-
-  df.push_back(chr_names, "chromosome");
-  df.push_back(chr_pos, "chr_pos");
-  df.push_back(ref_bases, "ref");
-  df.push_back(alt_bases, "alt");
+    return;
+  }
+
+  if (!Rf_isNewList(regions)) {
+    throw std::domain_error("The sequencing regions must be either a vector of "
+                            "chromosome names or a data frame having the "
+                            "columns \"chromosome\", \"begin\", and \"end\".");
+  }
+
+  const List regions_df(regions);
+  for (const auto& column: {"chromosome", "begin", "end"}) {
+    if (!regions_df.containsElementNamed(column)) {
+      throw std::domain_error("The sequencing regions data frame misses the "
+                              "column \"" + std::string(column) + "\".");
+    }
+  }
+
+  const auto chr_names = as<std::vector<std::string>>(regions_df["chromosome"]);
+  const auto begins = as<std::vector<long>>(regions_df["begin"]);
+  const auto ends = as<std::vector<long>>(regions_df["end"]);
+
+  for (size_t i=0; i<chr_names.size(); ++i) {
+    if (begins[i]<1 || begins[i]>ends[i]) {
+      throw std::domain_error("The sequencing region \"" + chr_names[i] + ":"
+                              + std::to_string(begins[i]) + "-"
+                              + std::to_string(ends[i]) + "\" is not valid.");
+    }
+
+    intervals[GenomicPosition::stochr(chr_names[i])].emplace_back(begins[i], ends[i]);
+  }
+
+  // sort and merge the intervals of each chromosome
+  for (auto& [chr_id, chr_intervals] : intervals) {
+    std::sort(chr_intervals.begin(), chr_intervals.end());
+
+    std::vector<Interval> merged;
+    for (const auto& interval : chr_intervals) {
+      if (merged.size()>0 && interval.first <= merged.back().second+1) {
+        merged.back().second = std::max(merged.back().second, interval.second);
+      } else {
+        merged.push_back(interval);
+      }
+    }
+
+    std::swap(chr_intervals, merged);
+  }
+}
+
+bool SequencingRegions::includes(const ChromosomeId& chr_id) const
+{
+  return whole_genome || intervals.count(chr_id)>0;
 }
 
-void add_sample_statistics(Rcpp::DataFrame& df,
-                           const Races::Mutations::SequencingSimulations::SampleStatistics& sample_statistics)
+bool SequencingRegions::contains(const Races::Mutations::GenomicPosition& position) const
 {
-  if (df.nrows()==0) {
-    add_SNV_data(df, sample_statistics);
+  if (whole_genome) {
+    return true;
   }
 
-  size_t num_of_mutations = sample_statistics.get_SNV_occurrences().size();
+  auto found = intervals.find(position.chr_id);
+  if (found == intervals.end()) {
+    return false;
+  }
 
-  if (num_of_mutations != static_cast<size_t>(df.nrows())) {
-    throw std::runtime_error("SeqSimResults are not canonical!!!");
+  const auto& chr_intervals = found->second;
+  if (chr_intervals.size()==0) {
+    return true;
   }
 
-  using namespace Rcpp;
+  // search the last interval beginning not after `position`
+  auto it = std::upper_bound(chr_intervals.begin(), chr_intervals.end(),
+                             Interval{position.position,
+                                      std::numeric_limits<ChrPosition>::max()});
+  if (it == chr_intervals.begin()) {
+    return false;
+  }
+
+  return (--it)->second >= position.position;
+}
+
+using SampleStatisticsShards = std::vector<const Races::Mutations::SequencingSimulations::SampleStatistics*>;
+
+/**
+ * @brief A map from bases to the codes of an R factor
+ *
+ * The four standard bases are always the first levels.
+ */
+class BaseFactorEncoder
+{
+  std::array<int, 256> codes;
+  std::vector<std::string> levels;
+public:
+  BaseFactorEncoder():
+    levels()
+  {
+    codes.fill(0);
+    for (const char base: {'A', 'C', 'G', 'T'}) {
+      (*this)(base);
+    }
+  }
+
+  inline int operator()(const char& base)
+  {
+    auto& code = codes[static_cast<unsigned char>(base)];
+    if (code == 0) {
+      levels.push_back(std::string(1, base));
+      code = static_cast<int>(levels.size());
+    }
+
+    return code;
+  }
+
+  inline const std::vector<std::string>& get_levels() const
+  {
+    return levels;
+  }
+};
+
+Rcpp::IntegerVector as_factor(Rcpp::IntegerVector codes, const std::vector<std::string>& levels)
+{
+  codes.attr("levels") = Rcpp::wrap(levels);
+  codes.attr("class") = "factor";
+
+  return codes;
+}
+
+Rcpp::List as_dataframe(Rcpp::List columns, const std::vector<std::string>& column_names,
+                        const size_t& num_of_rows)
+{
+  // the data frame is built in place to avoid copying the columns
+  columns.attr("names") = Rcpp::wrap(column_names);
+  columns.attr("row.names") = Rcpp::IntegerVector::create(NA_INTEGER,
+                                                          -static_cast<int>(num_of_rows));
+  columns.attr("class") = "data.frame";
+
+  return columns;
+}
+
+size_t count_SNVs_in(const SampleStatisticsShards& sample_shards,
+                     const SequencingRegions& regions)
+{
+  size_t num_of_mutations{0};
+  for (const auto& shard : sample_shards) {
+    for (const auto& [snv, occurrences] : shard->get_SNV_occurrences()) {
+      if (regions.contains(snv)) {
+        ++num_of_mutations;
+      }
+    }
+  }
+
+  return num_of_mutations;
+}
+
+void fill_SNV_data(Rcpp::IntegerVector& chr_codes, Rcpp::IntegerVector& chr_pos, 
+                   Rcpp::IntegerVector& ref_codes, Rcpp::IntegerVector& alt_codes,
+                   std::vector<std::string>& chr_levels, BaseFactorEncoder& base_encoder,
+                   const SampleStatisticsShards& sample_shards,
+                   const SequencingRegions& regions)
+{
   using namespace Races::Mutations;
 
-  DoubleVector VAF(num_of_mutations);
-  IntegerVector occurrences(num_of_mutations), coverages(num_of_mutations);
+  std::map<ChromosomeId, int> chr_code_map;
 
   size_t index{0};
-  auto coverage_it = sample_statistics.get_SNV_coverage().begin();
-  std::less<GenomicPosition> come_before; 
-  for (const auto& [snv, snv_occurrences] : sample_statistics.get_SNV_occurrences()) {
-    occurrences[index] = snv_occurrences;
-  
-    if (come_before(coverage_it->first, snv)) {
-      ++coverage_it;
-    }
-  
-    coverages[index] = coverage_it->second;
-    VAF[index] = static_cast<double>(snv_occurrences)/coverage_it->second;
-  
-    ++index;
-  }
-
-  const auto& sample_name = sample_statistics.get_sample_name();
-
-  df.push_back(occurrences, sample_name+".occurrences");
-  df.push_back(coverages, sample_name+".coverage");
-  df.push_back(VAF, sample_name+".VAF");
+  for (const auto& shard : sample_shards) {
+    for (const auto& [snv, occurrences] : shard->get_SNV_occurrences()) {
+      if (!regions.contains(snv)) {
+        continue;
+      }
+
+      auto found = chr_code_map.find(snv.chr_id);
+      if (found == chr_code_map.end()) {
+        chr_levels.push_back(GenomicPosition::chrtos(snv.chr_id));
+        found = chr_code_map.insert({snv.chr_id, static_cast<int>(chr_levels.size())}).first;
+      }
+
+      chr_codes[index] = found->second;
+      chr_pos[index] = snv.position;
+      ref_codes[index] = base_encoder(snv.ref_base);
+      alt_codes[index] = base_encoder(snv.alt_base);
+
+      ++index;
+    }
+  }
 }
 
-Rcpp::List get_result_dataframe(const Races::Mutations::SequencingSimulations::SampleSetStatistics& sample_set_statistics)
+void fill_sample_statistics(Rcpp::IntegerVector& occurrences, Rcpp::IntegerVector& coverages,
+                            Rcpp::DoubleVector& VAF, const size_t& offset,
+                            const size_t& num_of_mutations,
+                            const SampleStatisticsShards& sample_shards,
+                            const SequencingRegions& regions)
 {
-  auto df = Rcpp::DataFrame::create();
+  using namespace Races::Mutations;
+
+  size_t index{offset};
+  const size_t end{offset+num_of_mutations};
+
+  std::less<GenomicPosition> come_before;
+  for (const auto& shard : sample_shards) {
+    auto coverage_it = shard->get_SNV_coverage().begin();
+    for (const auto& [snv, snv_occurrences] : shard->get_SNV_occurrences()) {
+      if (come_before(coverage_it->first, snv)) {
+        ++coverage_it;
+      }
+
+      if (!regions.contains(snv)) {
+        continue;
+      }
+
+      if (index == end) {
+        throw std::runtime_error("SeqSimResults are not canonical!!!");
+      }
+
+      occurrences[index] = snv_occurrences;
+      coverages[index] = coverage_it->second;
+      VAF[index] = static_cast<double>(snv_occurrences)/coverage_it->second;
 
-  for (const auto& [sample_name, sample_stats] : sample_set_statistics) {
-    add_sample_statistics(df, sample_stats);
+      ++index;
+    }
+  }
+
+  if (index != end) {
+    throw std::runtime_error("SeqSimResults are not canonical!!!");
+  }
+}
+
+Rcpp::List get_result_dataframe(const std::vector<Races::Mutations::SequencingSimulations::SampleSetStatistics>& shard_statistics,
+                                const SequencingRegions& regions, const bool& long_format)
+{
+  using namespace Rcpp;
+
+  // the shards cover disjoint chromosomes and they are sorted by 
+  // chromosome: concatenating them preserves the SNV order
+  std::map<std::string, SampleStatisticsShards> sample_shards;
+
+  for (const auto& sample_set_statistics : shard_statistics) {
+    for (const auto& [sample_name, sample_stats] : sample_set_statistics) {
+      sample_shards[sample_name].push_back(&sample_stats);
+    }
+  }
+
+  if (sample_shards.size()==0) {
+    return DataFrame::create();
+  }
+
+  const size_t num_of_mutations = count_SNVs_in(sample_shards.begin()->second, regions);
+  const size_t num_of_samples = sample_shards.size();
+  const size_t num_of_rows = num_of_mutations*(long_format ? num_of_samples : 1);
+
+  IntegerVector chr_codes(num_of_rows), chr_pos(num_of_rows),
+                ref_codes(num_of_rows), alt_codes(num_of_rows);
+  std::vector<std::string> chr_levels;
+  BaseFactorEncoder base_encoder;
+
+  fill_SNV_data(chr_codes, chr_pos, ref_codes, alt_codes, chr_levels,
+                base_encoder, sample_shards.begin()->second, regions);
+
+  if (long_format) {
+    IntegerVector sample_codes(num_of_rows), occurrences(num_of_rows),
+                  coverages(num_of_rows);
+    DoubleVector VAF(num_of_rows);
+    std::vector<std::string> sample_names;
+
+    // the SNV data of the first sample are replicated for the others
+    for (const auto& column : {&chr_codes, &chr_pos, &ref_codes, &alt_codes}) {
+      auto first_block = column->begin();
+      for (size_t i=1; i<num_of_samples; ++i) {
+        std::copy(first_block, first_block+num_of_mutations, 
+                  column->begin()+i*num_of_mutations);
+      }
+    }
+
+    size_t offset{0};
+    for (const auto& [sample_name, shards] : sample_shards) {
+      sample_names.push_back(sample_name);
+
+      std::fill(sample_codes.begin()+offset, sample_codes.begin()+offset+num_of_mutations,
+                static_cast<int>(sample_names.size()));
+      fill_sample_statistics(occurrences, coverages, VAF, offset, num_of_mutations,
+                             shards, regions);
+
+      offset += num_of_mutations;
+    }
+
+    List columns = List::create(as_factor(sample_codes, sample_names),
+                                as_factor(chr_codes, chr_levels), chr_pos,
+                                as_factor(ref_codes, base_encoder.get_levels()),
+                                as_factor(alt_codes, base_encoder.get_levels()),
+                                occurrences, coverages, VAF);
+
+    return as_dataframe(columns, {"sample", "chromosome", "chr_pos", "ref", "alt",
+                                  "occurrences", "coverage", "VAF"}, num_of_rows);
   }
 
-  return df;
+  List columns(4+3*num_of_samples);
+  std::vector<std::string> column_names{"chromosome", "chr_pos", "ref", "alt"};
+
+  columns[0] = as_factor(chr_codes, chr_levels);
+  columns[1] = chr_pos;
+  columns[2] = as_factor(ref_codes, base_encoder.get_levels());
+  columns[3] = as_factor(alt_codes, base_encoder.get_levels());
+
+  size_t column{4};
+  for (const auto& [sample_name, shards] : sample_shards) {
+    IntegerVector occurrences(num_of_rows), coverages(num_of_rows);
+    DoubleVector VAF(num_of_rows);
+
+    fill_sample_statistics(occurrences, coverages, VAF, 0, num_of_mutations,
+                           shards, regions);
+
+    columns[column++] = occurrences;
+    columns[column++] = coverages;
+    columns[column++] = VAF;
+
+    column_names.push_back(sample_name+".occurrences");
+    column_names.push_back(sample_name+".coverage");
+    column_names.push_back(sample_name+".VAF");
+  }
+
+  return as_dataframe(columns, column_names, num_of_rows);
 }
 
 void
 split_by_epigenetic_status(std::list<Races::Mutations::SampleGenomeMutations>& FACS_samples,
-                           const Races::Mutations::SampleGenomeMutations& sample_mutations,
-                           std::map<Races::Mutants::SpeciesId, std::string> methylation_map)
+                           Races::Mutations::SampleGenomeMutations&& sample_mutations,
+                           const std::map<Races::Mutants::SpeciesId, std::string>& methylation_map)
 {
     using namespace Races::Mutants;
     using namespace Races::Mutants::Evolutions;
     using namespace Races::Mutations;
 
-    std::map<SpeciesId, SampleGenomeMutations*> meth_samples;
+    using CellMutationsList = decltype(sample_mutations.mutations);
 
-    for (const auto& cell_mutations : sample_mutations.mutations) {
-        auto found = meth_samples.find(cell_mutations->get_species_id());
+    // the cell mutations are moved, rather than copied, into one group
+    // per epigenetic label; the groups follow the label first occurrences
+    std::vector<std::pair<std::string, CellMutationsList>> label_groups;
 
-        if (found == meth_samples.end()) {
-            auto new_name = sample_mutations.name+"_"+
-                                methylation_map.at(cell_mutations->get_species_id());
+    for (auto& cell_mutations : sample_mutations.mutations) {
+        const auto& label = methylation_map.at(cell_mutations->get_species_id());
 
-            FACS_samples.emplace_back(new_name, sample_mutations.germline_mutations);
+        auto found = std::find_if(label_groups.begin(), label_groups.end(),
+                                  [&label](const auto& group) {
+                                      return group.first == label;
+                                  });
+        if (found == label_groups.end()) {
+            label_groups.emplace_back(label, CellMutationsList());
+            found = label_groups.end()-1;
+        }
 
-            FACS_samples.back().mutations.push_back(cell_mutations);
+        found->second.push_back(std::move(cell_mutations));
+    }
 
-            meth_samples.insert({cell_mutations->get_species_id(), &(FACS_samples.back())});
-        } else {
-            (found->second)->mutations.push_back(cell_mutations);
-        }
+    // the groups share the germline mutations of the sample rather
+    // than copying them
+    static_assert(std::is_same_v<decltype(sample_mutations.germline_mutations),
+                                 std::shared_ptr<GenomeMutations>>,
+                  "The germline mutations must be shared by pointer");
+
+    const auto germline_mutations = std::move(sample_mutations.germline_mutations);
+    for (auto& [label, group_mutations] : label_groups) {
+        FACS_samples.emplace_back(sample_mutations.name+"_"+label, germline_mutations);
+
+        FACS_samples.back().mutations = std::move(group_mutations);
     }
 }
 
 std::list<Races::Mutations::SampleGenomeMutations>
-split_by_epigenetic_status(const std::list<Races::Mutations::SampleGenomeMutations>& sample_mutations_list,
+split_by_epigenetic_status(std::list<Races::Mutations::SampleGenomeMutations>&& sample_mutations_list,
                            const PhylogeneticForest& forest)
 {
     using namespace Races::Mutants;
@@ -146,22 +421,41 @@ split_by_epigenetic_status(const std::list<Races::Mutations::SampleGenomeMutatio
 
     std::list<Races::Mutations::SampleGenomeMutations> FACS_samples;
 
-    for (const auto& sample_mutations : sample_mutations_list) {
-        split_by_epigenetic_status(FACS_samples, sample_mutations, methylation_map);
+    for (auto& sample_mutations : sample_mutations_list) {
+        split_by_epigenetic_status(FACS_samples, std::move(sample_mutations), methylation_map);
     }
+    sample_mutations_list.clear();
 
     return FACS_samples;
 }
 
+void move_shard_output(const std::filesystem::path& shard_path,
+                       const std::filesystem::path& output_path)
+{
+  if (!std::filesystem::exists(shard_path)) {
+    return;
+  }
+
+  for (const auto& entry : std::filesystem::directory_iterator(shard_path)) {
+    std::filesystem::rename(entry.path(), output_path/entry.path().filename());
+  }
+
+  std::filesystem::remove_all(shard_path);
+}
+
 Rcpp::List simulate_seq(const PhylogeneticForest& forest, const double& coverage, 
                         const int& read_size, const int& insert_size,
                         const std::string& output_dir, const bool& write_SAM,
-                        const bool& FACS, const int& rnd_seed)
+                        const bool& FACS, const int& rnd_seed, const int& num_threads,
+                        const SEXP& regions, const bool& long_format,
+                        const bool& profile)
 {
+  using namespace Races::Mutations;
   using namespace Races::Mutations::SequencingSimulations;
 
-  ReadSimulator<> simulator;
-  
+  const size_t num_workers = validate_num_threads(num_threads);
+  const SequencingRegions seq_regions(regions);
+
   if (!std::filesystem::exists(forest.get_reference_path())) {
     throw std::runtime_error("The reference genome file \"" + std::string(forest.get_reference_path())
                              + "\" does not exists anymore. Please, re-build the mutation engine.");
@@ -176,27 +470,109 @@ Rcpp::List simulate_seq(const PhylogeneticForest& forest, const double& coverage
     output_path = std::filesystem::temp_directory_path()/output_dir;
   }
 
-  if (insert_size==0) {
-    simulator = ReadSimulator<>(output_path, forest.get_reference_path(), read_size,
-                                ReadSimulator<>::Mode::CREATE, rnd_seed);
-  } else {
-    simulator = ReadSimulator<>(output_path, forest.get_reference_path(), read_size,
-                                insert_size, ReadSimulator<>::Mode::CREATE, rnd_seed);
+  if (std::filesystem::exists(output_path)) {
+    throw std::domain_error("The output directory \"" + std::string(output_path)
+                            + "\" already exists.");
   }
 
-  simulator.enable_SAM_writing(write_SAM);
+  std::filesystem::create_directory(output_path);
+
+  // if the simulation fails, the output directory is removed so that
+  // it does not prevent successive calls
+  struct OutputDirectoryGuard
+  {
+    std::filesystem::path path;
+    bool released{false};
+
+    ~OutputDirectoryGuard()
+    {
+      if (!released) {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+      }
+    }
+  } output_guard{output_path};
+
+  std::unique_ptr<Profiler> profiler;
+  if (profile) {
+    profiler = std::make_unique<Profiler>();
+  }
+
+  std::list<SampleGenomeMutations> mutations_list;
+  {
+    Profiler::ScopedTimer timer(profiler.get(), "sample mutation collection");
+
+    mutations_list = forest.get_sample_mutations_list();
+
+    if (FACS) {
+      mutations_list = split_by_epigenetic_status(std::move(mutations_list), forest);
+    }
+  }
 
-  auto mutations_list = forest.get_sample_mutations_list();
+  // every chromosome is an independent shard and its reads are
+  // generated by a dedicated simulator whose seed only depends on
+  // `rnd_seed` and the chromosome itself
+  std::vector<std::pair<ChromosomeId, std::filesystem::path>> shards;
+  {
+    Profiler::ScopedTimer timer(profiler.get(), "reference splitting");
 
-  if (FACS) {
-    mutations_list = split_by_epigenetic_status(mutations_list, forest);
+    for (const auto& [chr_id, chr_reference] : get_chromosome_references(forest.get_reference_path())) {
+      if (seq_regions.includes(chr_id)) {
+        shards.emplace_back(chr_id, chr_reference);
+      }
+    }
   }
+  std::vector<SampleSetStatistics> shard_statistics(shards.size());
+
+  Profiler::add(profiler.get(), "sequenced chromosomes", shards.size(),
+                "sequencing (wall-clock)");
+
+  {
+    Profiler::ScopedTimer timer(profiler.get(), "sequencing (wall-clock)");
+
+    run_in_parallel(shards.size(), num_workers, [&](const size_t i) {
+      const auto& [chr_id, chr_reference] = shards[i];
+
+      // summed over the shards
+      Profiler::ScopedTimer shard_timer(profiler.get(), "read simulation");
+
+      const auto shard_path = output_path/("shard_" + GenomicPosition::chrtos(chr_id));
+      const auto shard_seed = derive_task_seed(rnd_seed, chr_id);
+
+      ReadSimulator<> simulator;
+      if (insert_size==0) {
+        simulator = ReadSimulator<>(shard_path, chr_reference, read_size,
+                                    ReadSimulator<>::Mode::CREATE, shard_seed);
+      } else {
+        simulator = ReadSimulator<>(shard_path, chr_reference, read_size,
+                                    insert_size, ReadSimulator<>::Mode::CREATE, shard_seed);
+      }
 
-  auto result = simulator(mutations_list, coverage);
+      simulator.enable_SAM_writing(write_SAM);
+
+      shard_statistics[i] = simulator(mutations_list, coverage);
+    });
+  }
 
   if (remove_output_path) {
     std::filesystem::remove_all(output_path);
+  } else {
+    for (const auto& [chr_id, chr_reference] : shards) {
+      move_shard_output(output_path/("shard_" + GenomicPosition::chrtos(chr_id)), output_path);
+    }
+  }
+  output_guard.released = true;
+
+  Rcpp::List result;
+  {
+    Profiler::ScopedTimer timer(profiler.get(), "result conversion");
+
+    result = get_result_dataframe(shard_statistics, seq_regions, long_format);
+  }
+
+  if (profiler) {
+    result.attr("profile") = profiler->get_dataframe();
   }
 
-  return get_result_dataframe(result);
+  return result;
 }
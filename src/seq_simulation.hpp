@@ -18,15 +18,87 @@
 #ifndef __RRACES_SEQ_SIMULATION__
 #define __RRACES_SEQ_SIMULATION__
 
+#include <map>
+#include <array>
+#include <limits>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+#include <fstream>
+#include <filesystem>
+
 #include <Rcpp.h>
 
 #include <read_simulator.hpp>
 
 #include "phylogenetic_forest.hpp"
+#include "parallel_tasks.hpp"
+#include "profiler.hpp"
+#include "reference_cache.hpp"
+
+/**
+ * @brief The genomic regions to be sequenced
+ *
+ * A region set either covers the whole genome or a set of 
+ * chromosomes, some of which may be restricted to a set of 
+ * intervals, e.g., the loci of a panel. The reads are generated
+ * on all the included chromosomes: the intervals only filter the
+ * reported SNVs.
+ */
+class SequencingRegions
+{
+  using ChromosomeId = Races::Mutations::ChromosomeId;
+  using ChrPosition = Races::Mutations::ChrPosition;
+  using Interval = std::pair<ChrPosition, ChrPosition>;
+
+  bool whole_genome;    //!< a Boolean flag for whole genome sequencing
+
+  /**
+   * @brief The sorted and disjoint intervals of each chromosome
+   *
+   * An empty interval vector denotes the whole chromosome.
+   */
+  std::map<ChromosomeId, std::vector<Interval>> intervals;
+public:
+  /**
+   * @brief The whole genome region constructor
+   */
+  SequencingRegions();
+
+  /**
+   * @brief Build the regions from an R object
+   *
+   * @param regions is either `NULL`, for the whole genome, a vector
+   *        of chromosome names, or a data frame having the columns
+   *        `chromosome`, `begin`, and `end`
+   */
+  explicit SequencingRegions(const SEXP& regions);
+
+  /**
+   * @brief Test whether a chromosome must be sequenced
+   *
+   * @param chr_id is the identifier of the chromosome
+   * @return `true` if and only if the regions contain at least
+   *        one locus of the chromosome `chr_id`
+   */
+  bool includes(const ChromosomeId& chr_id) const;
+
+  /**
+   * @brief Test whether a genomic position belongs to the regions
+   *
+   * @param position is a genomic position
+   * @return `true` if and only if `position` belongs to the regions
+   */
+  bool contains(const Races::Mutations::GenomicPosition& position) const;
+};
 
 Rcpp::List  simulate_seq(const PhylogeneticForest& forest, const double& coverage, 
                          const int& read_size, const int& insert_size,
                          const std::string& output_dir, const bool& write_SAM,
-                         const bool& FACS, const int& rnd_seed);
+                         const bool& FACS, const int& rnd_seed,
+                         const int& num_threads, const SEXP& regions,
+                         const bool& long_format, const bool& profile);
 
 #endif // __RRACES_SEQ_SIMULATION__
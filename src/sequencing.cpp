@@ -39,24 +39,58 @@ RCPP_MODULE(Sequencing){
 //'              (default: FALSE).
 //' @param epi_FACS Perform an epigenetic FACS analysis (default: FALSE).
 //' @param rnd_seed The random seed for the internal random generator 
-//'              (default value: 0).
+//'              (default value: 0). The reads of each chromosome are
+//'              generated by a dedicated random generator whose seed is
+//'              derived from `rnd_seed`; because of this, the results
+//'              differ from those produced for the same seed by the
+//'              rRACES versions that used a single generator for the
+//'              whole genome.
+//' @param num_threads The number of threads used to simulate the
+//'              sequencing. The reads of each chromosome are
+//'              simulated independently and the result does not
+//'              depend on this value (default value: 1).
+//' @param regions The regions to be sequenced. It is either `NULL`,
+//'              to sequence the whole genome, a vector of chromosome
+//'              names, or a data frame whose columns `chromosome`,
+//'              `begin`, and `end` describe the targeted loci, e.g.,
+//'              those of a panel. Reads are exclusively generated on
+//'              the selected chromosomes and only the SNVs in the
+//'              regions are reported. The loci of a data frame are an
+//'              output filter: the reads of a selected chromosome, and
+//'              the SAM files, cover the whole chromosome, so loci
+//'              restrictions do not speed up the simulation. Only
+//'              excluding chromosomes does (default value: `NULL`).
+//' @param long_format A Boolean flag to get the result in long format,
+//'              i.e., one row per SNV and sample (default: FALSE).
+//' @param profile A Boolean flag to profile the sequencing simulation.
+//'              When it is TRUE, the returned data frame has the
+//'              attribute `profile`, a data frame reporting "name",
+//'              "type", "calls", "value", and "rate" of the timers
+//'              and the counters of the simulation phases
+//'              (default: FALSE).
 //' @return A data frame representing, for each of the observed
 //'         SNVs, the chromosome and the position in which
 //'         it occurs (columns `chromosome` and `chr_pos`),
-//'         the SNV context and the new base (columns `context`
-//'         and `alt_base`). Moreover, for each of the 
+//'         the reference and the alternative bases (columns 
+//'         `ref` and `alt`). The columns `chromosome`, `ref`, and 
+//'         `alt` are factors. Moreover, for each of the 
 //'         sequencied samples `<sample name>`, the returned data 
 //'         frame contains three columns: the number of reads 
 //'         in which the corresponding SNV occurs 
 //'         (column `<sample name>.occurrences`), the coverage of
 //'         the SNV locus (column `<sample name>.coverage`), and the
 //'         corresponding VAF (column `<sample name>.VAF`).
+//'         When `long_format` is TRUE, the data frame contains
+//'         the factor column `sample` and the columns `occurrences`,
+//'         `coverage`, and `VAF` instead of the per-sample ones.
 //' @seealso `vignette("sequencing")` for usage examples
   function("simulate_seq", &simulate_seq,
            List::create(_["phylo_forest"], _["coverage"]=1,
                         _["read_size"] = 150, _["insert_size"] = 0,
                         _["output_dir"] = "rRACES_SAM",
                         _["write_SAM"] = false, _["epi_FACS"] = false, 
-                        _["rnd_seed"] = 0),
+                        _["rnd_seed"] = 0, _["num_threads"] = 1,
+                        _["regions"] = R_NilValue,
+                        _["long_format"] = false, _["profile"] = false),
            "Simulate the sequencing of the samples in a phylogenetic forest");
 }
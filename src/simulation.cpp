@@ -15,26 +15,68 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <map>
+#include <chrono>
+#include <limits>
 #include <algorithm>
 #include <filesystem>
 
 #include <ending_conditions.hpp>
 
 #include "simulation.hpp"
+#include "summed_area_table.hpp"
+#include "parallel_tasks.hpp"
 
 
 template<typename SIMULATION_TEST>
 struct RTest : public SIMULATION_TEST
 {
   size_t counter;
+  size_t num_of_calls;            //!< the number of test calls, i.e., loop iterations plus one
+
+  const ::Simulation* wrapper;    //!< the simulation wrapper calling the step callback
+  const StepCallback* callback;   //!< the step callback (if any)
+  size_t events_since_callback;   //!< the number of events since the last callback call
+  Races::Time next_callback_time; //!< the simulated time of the next callback call
 
   template<typename ...Args>
   explicit RTest(Args...args):
-      SIMULATION_TEST(args...), counter{0}
+      SIMULATION_TEST(args...), counter{0}, num_of_calls{0}, wrapper{nullptr}, callback{nullptr},
+      events_since_callback{0}, next_callback_time{0}
   {}
 
+  void set_step_callback(const ::Simulation& wrapper, const StepCallback* callback)
+  {
+    this->wrapper = &wrapper;
+    this->callback = callback;
+
+    if (callback != nullptr) {
+      next_callback_time = wrapper.get_clock() + callback->time_delta;
+    }
+  }
+
+  inline bool is_callback_due(const Races::Mutants::Evolutions::Simulation& simulation)
+  {
+    if (callback->num_of_events>0 && ++events_since_callback >= callback->num_of_events) {
+      return true;
+    }
+
+    return (callback->time_delta>0 && simulation.get_time() >= next_callback_time);
+  }
+
   bool operator()(const Races::Mutants::Evolutions::Simulation& simulation)
   {
+    ++num_of_calls;
+
+    if (callback != nullptr && is_callback_due(simulation)) {
+      events_since_callback = 0;
+      next_callback_time = simulation.get_time() + callback->time_delta;
+
+      if (wrapper->call_step_callback()) {
+        return true;
+      }
+    }
+
     if (++counter >= 10000) {
       counter = 0;
       try {
@@ -50,6 +92,24 @@ struct RTest : public SIMULATION_TEST
   }
 };
 
+template<typename SIMULATION_TEST>
+struct AsyncTest : public SIMULATION_TEST
+{
+  AsyncRun& async_run;
+
+  template<typename ...Args>
+  explicit AsyncTest(AsyncRun& async_run, Args...args):
+      SIMULATION_TEST(args...), async_run{async_run}
+  {}
+
+  bool operator()(const Races::Mutants::Evolutions::Simulation& simulation)
+  {
+    async_run.clock = simulation.get_time();
+
+    return async_run.stop_requested || SIMULATION_TEST::operator()(simulation);
+  }
+};
+
 const std::map<std::string, Races::Mutants::CellEventType> event_names{
   {"death",  Races::Mutants::CellEventType::DEATH},
   {"growth", Races::Mutants::CellEventType::DUPLICATION},
@@ -141,51 +201,6 @@ get_rectangle(const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower
   return {l_position, u_position};
 }
 
-size_t count_driver_mutated_cells(const Races::Mutants::Evolutions::Tissue& tissue,
-                                  const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
-                                  const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
-                                  const std::set<Races::Mutants::SpeciesId>& species_filter,
-                                  const std::set<std::string>& epigenetic_filter)
-{
-  using namespace Races::Mutants;
-  using namespace Races::Mutants::Evolutions;
-
-  if (lower_corner.size() != upper_corner.size()) {
-    ::Rf_error("lower_corner and upper_corner must have the same size");
-  }
-
-  auto lower_it = lower_corner.begin();
-  auto upper_it = upper_corner.begin();
-  for (;lower_it!=lower_corner.end();++lower_it,++upper_it)
-  {
-    if (*lower_it>*upper_it) {
-      return 0;
-    }
-  }
-
-  size_t total{0};
-  for (auto x=lower_corner[0]; x<=upper_corner[0]; ++x) {
-    for (auto y=lower_corner[1]; y<=upper_corner[1]; ++y) {
-      auto cell_proxy = tissue({x,y});
-      if (!cell_proxy.is_wild_type()) {
-        const CellInTissue& cell = cell_proxy;
-
-        if (species_filter.count(cell.get_species_id())>0) {
-
-          const auto& species = tissue.get_species(cell.get_species_id());
-          auto sign_string = get_signature_string(species);
-
-          if (epigenetic_filter.count(sign_string)>0) {
-            ++total;
-          }
-        }
-      }
-    }
-  }
-
-  return total;
-}
-
 std::vector<Races::Mutants::Evolutions::Direction> Simulation::get_possible_directions()
 {
   namespace RS = Races::Mutants::Evolutions;
@@ -252,17 +267,87 @@ bool Simulation::has_names_in(const Rcpp::List& list, std::set<std::string> aime
   return true;
 }
 
+/**
+ * @brief The factor level codes of the species mutants and epigenetic states
+ *
+ * `mutant_codes[id]` and `epistate_codes[id]` are the 1-based indices
+ * in `mutant_levels` and `epistate_levels`, respectively, of the 
+ * mutant name and the epigenetic state of the species `id`.
+ */
+struct SpeciesFactorCodes
+{
+  std::vector<int> mutant_codes;
+  std::vector<int> epistate_codes;
+  std::vector<std::string> mutant_levels;
+  std::vector<std::string> epistate_levels;
+
+  explicit SpeciesFactorCodes(const Races::Mutants::Evolutions::Tissue& tissue)
+  {
+    std::map<std::string, int> mutant_map, epistate_map;
+    for (const auto& species: tissue) {
+      const auto species_id = species.get_id();
+
+      if (mutant_codes.size() <= species_id) {
+        mutant_codes.resize(species_id+1, 0);
+        epistate_codes.resize(species_id+1, 0);
+      }
+
+      mutant_codes[species_id] = get_code(mutant_map, mutant_levels, 
+                                          species.get_mutant_name());
+      epistate_codes[species_id] = get_code(epistate_map, epistate_levels,
+                                            get_signature_string(species));
+    }
+  }
+private:
+  static int get_code(std::map<std::string, int>& code_map, std::vector<std::string>& levels,
+                      const std::string& value)
+  {
+    auto found = code_map.find(value);
+    if (found == code_map.end()) {
+      levels.push_back(value);
+      found = code_map.insert({value, static_cast<int>(levels.size())}).first;
+    }
+
+    return found->second;
+  }
+};
+
+Rcpp::IntegerVector as_factor(const std::vector<int>& codes, const std::vector<std::string>& levels)
+{
+  Rcpp::IntegerVector factor(codes.begin(), codes.end());
+
+  factor.attr("levels") = Rcpp::wrap(levels);
+  factor.attr("class") = "factor";
+
+  return factor;
+}
+
+Rcpp::CharacterVector as_character(const std::vector<int>& codes, const std::vector<std::string>& levels)
+{
+  Rcpp::CharacterVector strings(codes.size());
+
+  Rcpp::CharacterVector r_levels = Rcpp::wrap(levels);
+  for (size_t i=0; i<codes.size(); ++i) {
+    strings[i] = r_levels[codes[i]-1];
+  }
+
+  return strings;
+}
+
 Rcpp::List 
 Simulation::get_cells(const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
                       const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
                       const std::set<Races::Mutants::SpeciesId> &species_filter,
-                      const std::set<std::string> &epigenetic_filter) const
+                      const std::set<std::string> &epigenetic_filter,
+                      const size_t& stride, const bool& as_factors) const
 {
   using namespace Rcpp;
   using namespace Races::Mutants;
 
   namespace RS = Races::Mutants::Evolutions;
 
+  Profiler::ScopedTimer timer(profiler.get(), "cell collection");
+
   if (lower_corner.size() != 2) {
     ::Rf_error("The lower corner must be a vector having size 2");
   }
@@ -271,44 +356,82 @@ Simulation::get_cells(const std::vector<Races::Mutants::Evolutions::AxisPosition
     ::Rf_error("The upper corner must be a vector having size 2");
   }
 
-  size_t num_of_rows = count_driver_mutated_cells(sim_ptr->tissue(), lower_corner, upper_corner,
-                                                  species_filter, epigenetic_filter);
-
-  IntegerVector ids(num_of_rows);
-  CharacterVector mutant_names(num_of_rows), epi_states(num_of_rows);
-  IntegerVector x_pos(num_of_rows), y_pos(num_of_rows);
-
-  size_t i{0};
-  for (auto x=lower_corner[0]; x<=upper_corner[0]; ++x) {
-    for (auto y=lower_corner[1]; y<=upper_corner[1]; ++y) {
-      auto cell_proxy = sim_ptr->tissue()({x,y});
-      if(!cell_proxy.is_wild_type()) {
+  if (stride == 0) {
+    ::Rf_error("The stride must be a positive number");
+  }
 
-        const RS::CellInTissue& cell = cell_proxy;
+  const auto& tissue = simulation().tissue();
 
-        const auto& species = sim_ptr->tissue().get_species(cell.get_species_id());
-        const auto sign_string = get_signature_string(species);
+  // the filters are evaluated once per species: `accepted[id]` is 
+  // true if and only if the cells of the species `id` must be 
+  // collected
+  const SpeciesFactorCodes species_codes(tissue);
 
-        if (species_filter.count(cell.get_species_id())>0
-              && epigenetic_filter.count(sign_string)>0) {
+  std::vector<bool> accepted(species_codes.mutant_codes.size(), false);
+  for (const auto& species: tissue) {
+    accepted[species.get_id()] = (species_filter.count(species.get_id())>0
+                                    && epigenetic_filter.count(get_signature_string(species))>0);
+  }
 
-          ids[i] = cell.get_id();
-          mutant_names[i] = species.get_mutant_name();
+  std::vector<int> ids, mutants, epi_states, x_pos, y_pos;
 
-          epi_states[i] = sign_string;
+  std::vector<size_t> first{lower_corner[0], lower_corner[1]},
+                      last{upper_corner[0], upper_corner[1]};
 
-          x_pos[i] = x;
-          y_pos[i] = y;
+  // all the cells outside the tumour bounding box are wild-type: when
+  // the scanned region is larger than the tumour, the scan is clipped
+  // to the bounding box, keeping the stride alignment
+  size_t num_of_cells{0};
+  for (const auto& species: tissue) {
+    num_of_cells += species.num_of_cells();
+  }
+  if (first[0]<=last[0] && first[1]<=last[1]
+      && (last[0]-first[0]+1)*(last[1]-first[1]+1) > num_of_cells) {
+    const auto bbox = get_tumor_bounding_box();
+    const std::vector<size_t> bbox_lower{bbox.lower_corner.x, bbox.lower_corner.y},
+                              bbox_upper{bbox.upper_corner.x, bbox.upper_corner.y};
+
+    for (size_t axis=0; axis<2; ++axis) {
+      if (bbox_lower[axis] > first[axis]) {
+        first[axis] += stride*(1+(bbox_lower[axis]-first[axis]-1)/stride);
+      }
+      last[axis] = std::min(last[axis], bbox_upper[axis]);
+    }
+  }
 
-          ++i;
+  if (first[0]<=last[0] && first[1]<=last[1]) {
+    for (size_t x=first[0]; x<=last[0]; x+=stride) {
+      for (size_t y=first[1]; y<=last[1]; y+=stride) {
+        auto cell_proxy = tissue({static_cast<RS::AxisPosition>(x),
+                                  static_cast<RS::AxisPosition>(y)});
+        if(!cell_proxy.is_wild_type()) {
+
+          const RS::CellInTissue& cell = cell_proxy;
+          const auto species_id = cell.get_species_id();
+
+          if (accepted[species_id]) {
+            ids.push_back(cell.get_id());
+            mutants.push_back(species_codes.mutant_codes[species_id]);
+            epi_states.push_back(species_codes.epistate_codes[species_id]);
+            x_pos.push_back(x);
+            y_pos.push_back(y);
+          }
         }
       }
     }
   }
 
-  return DataFrame::create(_["cell_id"]=ids, _["mutant"]=mutant_names,
-                            _["epistate"]=epi_states, _["position_x"]=x_pos,
-                            _["position_y"]=y_pos);
+  if (as_factors) {
+    return DataFrame::create(_["cell_id"]=ids, 
+                             _["mutant"]=as_factor(mutants, species_codes.mutant_levels),
+                             _["epistate"]=as_factor(epi_states, species_codes.epistate_levels),
+                             _["position_x"]=x_pos, _["position_y"]=y_pos);
+  }
+
+  return DataFrame::create(_["cell_id"]=ids, 
+                           _["mutant"]=as_character(mutants, species_codes.mutant_levels),
+                           _["epistate"]=as_character(epi_states, species_codes.epistate_levels),
+                           _["position_x"]=x_pos, _["position_y"]=y_pos);
 }
 
 Rcpp::List Simulation::wrap_a_cell(const Races::Mutants::Evolutions::CellInTissue& cell) const
@@ -316,9 +439,9 @@ Rcpp::List Simulation::wrap_a_cell(const Races::Mutants::Evolutions::CellInTissu
   using namespace Rcpp;
   using namespace Races::Mutants;
 
-  const auto& species = sim_ptr->tissue().get_species(cell.get_species_id());
+  const auto& species = simulation().tissue().get_species(cell.get_species_id());
 
-  const auto& mutant_name = sim_ptr->find_mutant_name(species.get_mutant_id());
+  const auto& mutant_name = simulation().find_mutant_name(species.get_mutant_id());
 
   auto epistate = MutantProperties::signature_to_string(species.get_methylation_signature());
 
@@ -381,6 +504,13 @@ get_tmp_path()
   return tmp_path;
 }
 
+std::filesystem::path Simulation::new_tmp_directory()
+{
+  tmp_directory = get_tmp_path();
+
+  return tmp_directory;
+}
+
 void Simulation::init(const SEXP& sexp)
 {
   using namespace Rcpp;
@@ -397,7 +527,7 @@ void Simulation::init(const SEXP& sexp)
       if (save_snapshots) {
         sim_ptr = std::make_shared<RS::Simulation>(name, seed);
       } else {
-        sim_ptr = std::make_shared<RS::Simulation>(get_tmp_path(), seed);
+        sim_ptr = std::make_shared<RS::Simulation>(new_tmp_directory(), seed);
       }
       break;
     }
@@ -407,7 +537,7 @@ void Simulation::init(const SEXP& sexp)
       if (save_snapshots) {
         sim_ptr = std::make_shared<RS::Simulation>(name);
       } else {
-        sim_ptr = std::make_shared<RS::Simulation>(get_tmp_path());
+        sim_ptr = std::make_shared<RS::Simulation>(new_tmp_directory());
       }
       break;
     }
@@ -423,9 +553,10 @@ void Simulation::init(const SEXP& sexp)
 }
 
 Simulation::Simulation():
-  sim_ptr(std::make_shared<Races::Mutants::Evolutions::Simulation>(get_tmp_path())),
   name(get_default_name()), save_snapshots(false)
-{}
+{
+  sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(new_tmp_directory());
+}
 
 Simulation::Simulation(const SEXP& sexp):
   save_snapshots(false)
@@ -439,7 +570,7 @@ Simulation::Simulation(const SEXP& sexp):
     if (save_snapshots) {
       sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(name);
     } else {
-      sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(get_tmp_path());
+      sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(new_tmp_directory());
     }
 
     return;
@@ -486,7 +617,7 @@ Simulation::Simulation(const SEXP& first_param, const SEXP& second_param):
   name = as<std::string>(first_param);
   int seed = as<int>(second_param);
 
-  sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(get_tmp_path(), seed);
+  sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(new_tmp_directory(), seed);
 }
 
 Simulation::Simulation(const std::string& simulation_name, const int& seed, const bool& save_snapshots):
@@ -495,18 +626,84 @@ Simulation::Simulation(const std::string& simulation_name, const int& seed, cons
   if (save_snapshots) {
     sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(simulation_name, seed);
   } else {
-    sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(get_tmp_path(), seed);
+    sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(new_tmp_directory(), seed);
   }
 }
 
+double Simulation::get_disk_usage() const
+{
+  namespace fs = std::filesystem;
+
+  const auto directory = simulation().get_logger().get_directory();
+
+  double disk_usage{0};
+  if (fs::exists(directory)) {
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+      if (entry.is_regular_file()) {
+        disk_usage += entry.file_size();
+      }
+    }
+  }
+
+  return disk_usage;
+}
+
+Simulation Simulation::fork() const
+{
+  namespace fs = std::filesystem;
+
+  // the log of this simulation must be completely on disk before being
+  // copied for the fork
+  simulation().get_logger().flush_archives();
+
+  Simulation forked;
+  forked.name = name;
+
+  // the RACES simulation is copied in memory: the copy logs into the
+  // directory of this simulation until it is moved below
+  const auto unused_directory = forked.tmp_directory;
+  forked.sim_ptr = std::make_shared<Races::Mutants::Evolutions::Simulation>(simulation());
+
+  // the fork logs into a private copy of the log, so that it keeps the
+  // pre-fork lineage without writing into, or deleting, the directory
+  // of this simulation
+  const auto log_directory = simulation().get_logger().get_directory();
+  const auto fork_directory = forked.new_tmp_directory();
+  if (fs::exists(log_directory)) {
+    fs::copy(log_directory, fork_directory, fs::copy_options::recursive);
+  }
+  forked.sim_ptr->rename_log_directory(fork_directory);
+
+  if (fs::exists(unused_directory)) {
+    fs::remove_all(unused_directory);
+  }
+
+  forked.step_callback = step_callback;
+  if (profiler) {
+    forked.profiler = std::make_shared<Profiler>(*profiler);
+  }
+
+  return forked;
+}
+
 Simulation::~Simulation()
 {
+  // stop and join the background run, if any
+  if (async_run.use_count()==1) {
+    async_run.reset();
+  }
+
+  // only the temporary directories created by this object are removed
   if (sim_ptr.use_count()==1 && !save_snapshots) {
     auto dir = sim_ptr->get_logger().get_directory();
 
     sim_ptr = std::shared_ptr<Races::Mutants::Evolutions::Simulation>();
 
-    std::filesystem::remove_all(dir);
+    if (!tmp_directory.empty()
+        && std::filesystem::absolute(dir).lexically_normal()
+              == std::filesystem::absolute(tmp_directory).lexically_normal()) {
+      std::filesystem::remove_all(dir);
+    }
   }
 }
 
@@ -546,7 +743,7 @@ void Simulation::add_mutant(const std::string& mutant_name, const Rcpp::List& ep
     }
   }
 
-  sim_ptr->add_mutant(real_mutant);
+  simulation().add_mutant(real_mutant);
 }
 
 void Simulation::add_mutant(const std::string& mutant_name, const double& growth_rate,
@@ -563,13 +760,13 @@ void Simulation::add_mutant(const std::string& mutant_name, const double& growth
   real_mutant[""].set_rate(CellEventType::DUPLICATION, growth_rate);
   real_mutant[""].set_rate(CellEventType::DEATH, death_rate);
 
-  sim_ptr->add_mutant(real_mutant);
+  simulation().add_mutant(real_mutant);
 }
 
 Rcpp::List Simulation::get_species() const
 {
   using namespace Rcpp;
-  size_t num_of_rows = sim_ptr->tissue().num_of_species();
+  size_t num_of_rows = simulation().tissue().num_of_species();
 
   CharacterVector mutant_names(num_of_rows), epi_states(num_of_rows);
   NumericVector switch_rates(num_of_rows), duplication_rates(num_of_rows),
@@ -578,7 +775,7 @@ Rcpp::List Simulation::get_species() const
   using namespace Races::Mutants;
 
   size_t i{0};
-  for (const auto& species: sim_ptr->tissue()) {
+  for (const auto& species: simulation().tissue()) {
     mutant_names[i] = species.get_mutant_name();
     duplication_rates[i] = species.get_rate(CellEventType::DUPLICATION);
     death_rates[i] = species.get_rate(CellEventType::DEATH);
@@ -609,20 +806,20 @@ void Simulation::place_cell(const std::string& species_name,
                             const Races::Mutants::Evolutions::AxisPosition& x,
                             const Races::Mutants::Evolutions::AxisPosition& y)
 {
-  if (sim_ptr->tissue().num_of_mutated_cells()>0) {
+  if (simulation().tissue().num_of_mutated_cells()>0) {
     Rcpp::warning("Warning: the tissue already contains a cell.");
   }
 
-  const auto& species = sim_ptr->tissue().get_species(species_name);
+  const auto& species = simulation().tissue().get_species(species_name);
 
-  sim_ptr->place_cell(species.get_id(), {x,y});
+  simulation().place_cell(species.get_id(), {x,y});
 }
 
 Rcpp::List Simulation::get_cells() const
 {
   namespace RS = Races::Mutants::Evolutions;
 
-  std::vector<RS::AxisPosition> upper_corner = sim_ptr->tissue().size();
+  std::vector<RS::AxisPosition> upper_corner = simulation().tissue().size();
   upper_corner.resize(2);
 
   for (auto& value : upper_corner) {
@@ -637,7 +834,7 @@ Rcpp::List Simulation::get_cell(const Races::Mutants::Evolutions::AxisPosition&
 {
   namespace RS = Races::Mutants::Evolutions;
 
-  const RS::CellInTissue& cell = sim_ptr->tissue()({x,y});
+  const RS::CellInTissue& cell = simulation().tissue()({x,y});
 
   return wrap_a_cell(cell);
 }
@@ -647,11 +844,11 @@ Rcpp::List Simulation::get_cells(const std::vector<Races::Mutants::Evolutions::A
 {
   std::set<Races::Mutants::SpeciesId> species_ids;
 
-  for (const auto& species: sim_ptr->tissue()) {
+  for (const auto& species: simulation().tissue()) {
     species_ids.insert(species.get_id());
   }
 
-  return get_cells(lower_corner, upper_corner, species_ids, {"+", "-", ""});
+  return get_cells(lower_corner, upper_corner, species_ids, {"+", "-", ""}, 1, false);
 }
 
 Rcpp::List Simulation::get_cells(const SEXP& first_param, const SEXP& second_param) const
@@ -694,7 +891,7 @@ Rcpp::List Simulation::get_cells(const std::vector<std::string>& species_filter,
 {
   namespace RS = Races::Mutants::Evolutions;
 
-  std::vector<RS::AxisPosition> upper_corner = sim_ptr->tissue().size();
+  std::vector<RS::AxisPosition> upper_corner = simulation().tissue().size();
   upper_corner.resize(2);
 
   for (auto& value : upper_corner) {
@@ -708,13 +905,23 @@ Rcpp::List Simulation::get_cells(const std::vector<Races::Mutants::Evolutions::A
                            const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
                            const std::vector<std::string>& mutant_filter,
                            const std::vector<std::string>& epigenetic_filter) const
+{
+  return get_cells(lower_corner, upper_corner, mutant_filter, epigenetic_filter, 1, false);
+}
+
+Rcpp::List Simulation::get_cells(const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
+                           const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
+                           const std::vector<std::string>& mutant_filter,
+                           const std::vector<std::string>& epigenetic_filter,
+                           const size_t& stride, const bool& as_factors) const
 {
   std::set<std::string> mutant_set(mutant_filter.begin(), mutant_filter.end());
   std::set<std::string> epigenetic_set(epigenetic_filter.begin(), epigenetic_filter.end());
 
-  auto species_ids = get_species_ids_from_mutant_name(sim_ptr->tissue(), mutant_set);
+  auto species_ids = get_species_ids_from_mutant_name(simulation().tissue(), mutant_set);
 
-  return get_cells(lower_corner, upper_corner, species_ids, epigenetic_set);
+  return get_cells(lower_corner, upper_corner, species_ids, epigenetic_set,
+                   stride, as_factors);
 }
 
 Rcpp::List Simulation::get_counts() const
@@ -722,14 +929,14 @@ Rcpp::List Simulation::get_counts() const
   using namespace Rcpp;
   using namespace Races::Mutants;
 
-  size_t num_of_rows = sim_ptr->tissue().num_of_species();
+  size_t num_of_rows = simulation().tissue().num_of_species();
 
   CharacterVector mutant_names(num_of_rows);
   CharacterVector epi_states(num_of_rows);
   IntegerVector counts(num_of_rows);
 
   size_t i{0};
-  for (const auto& species: sim_ptr->tissue()) {
+  for (const auto& species: simulation().tissue()) {
     mutant_names[i] = species.get_mutant_name();
     epi_states[i] = get_signature_string(species);
     counts[i] = species.num_of_cells();
@@ -758,16 +965,16 @@ Rcpp::List Simulation::get_added_cells() const
 
   namespace RS = Races::Mutants::Evolutions;
 
-  size_t num_of_rows = sim_ptr->get_added_cells().size();
+  size_t num_of_rows = simulation().get_added_cells().size();
 
   CharacterVector mutant_names(num_of_rows),  epi_states(num_of_rows);
   IntegerVector position_x(num_of_rows), position_y(num_of_rows);
   NumericVector time(num_of_rows);
 
   size_t i{0};
-  for (const auto& added_cell: sim_ptr->get_added_cells()) {
-    const auto& species = sim_ptr->tissue().get_species(added_cell.species_id);
-    mutant_names[i] = sim_ptr->find_mutant_name(species.get_mutant_id());
+  for (const auto& added_cell: simulation().get_added_cells()) {
+    const auto& species = simulation().tissue().get_species(added_cell.species_id);
+    mutant_names[i] = simulation().find_mutant_name(species.get_mutant_id());
     epi_states[i] = get_signature_string(species);
     position_x[i] = added_cell.x;
     position_y[i] = added_cell.y;
@@ -827,9 +1034,9 @@ std::vector<TimedLineageEdge> sorted_timed_edges(const Races::Mutants::Evolution
 Rcpp::List Simulation::get_lineage_graph() const
 {
   using namespace Rcpp;
-  const auto species_id2name = get_species_id2name(sim_ptr->tissue());
+  const auto species_id2name = get_species_id2name(simulation().tissue());
 
-  const auto timed_edges = sorted_timed_edges(*sim_ptr);
+  const auto timed_edges = sorted_timed_edges(simulation());
 
   CharacterVector ancestors(timed_edges.size()), progeny(timed_edges.size());
   NumericVector first_cross(timed_edges.size());
@@ -859,28 +1066,88 @@ inline void validate_non_empty_tissue(const Races::Mutants::Evolutions::Tissue&
   }
 }
 
+void Simulation::validate_not_running() const
+{
+  if (async_run && async_run->running) {
+    throw std::runtime_error("The simulation is running in background: "
+                             "either wait for it or stop it.");
+  }
+}
+
+Races::Mutants::Evolutions::Simulation& Simulation::simulation() const
+{
+  validate_not_running();
+
+  return *sim_ptr;
+}
+
+template<typename SIMULATION_TEST>
+void Simulation::profiled_run(SIMULATION_TEST& ending_test, Races::UI::ProgressBar& bar)
+{
+  if (!profiler) {
+    simulation().run(ending_test, bar);
+
+    return;
+  }
+
+  const size_t initial_calls = ending_test.num_of_calls;
+  const double initial_time = simulation().get_time();
+  const double initial_disk_usage = get_disk_usage();
+
+  {
+    Profiler::ScopedTimer timer(profiler.get(), "evolution");
+
+    simulation().run(ending_test, bar);
+  }
+
+  // the ending test is evaluated at every iteration of the evolution
+  // loop and once more when the evolution stops. An iteration usually
+  // fires one event, but this is not guaranteed
+  const size_t test_calls = ending_test.num_of_calls-initial_calls;
+  Profiler::add(profiler.get(), "loop iterations",
+                (test_calls>0? test_calls-1: 0), "evolution");
+  Profiler::add(profiler.get(), "simulated time",
+                simulation().get_time()-initial_time, "evolution");
+
+  // the logger may buffer some data: the growth of the simulation
+  // directory approximates the logged bytes
+  Profiler::add(profiler.get(), "disk usage growth",
+                get_disk_usage()-initial_disk_usage, "evolution");
+}
+
+void Simulation::set_profiling(const bool& enabled)
+{
+  if (!enabled) {
+    profiler.reset();
+  } else if (!profiler) {
+    profiler = std::make_shared<Profiler>();
+  }
+}
+
 void Simulation::run_up_to_time(const Races::Time& time)
 {
-  validate_non_empty_tissue(sim_ptr->tissue());
+  validate_non_empty_tissue(simulation().tissue());
 
   Races::UI::ProgressBar bar;
 
   RTest<Races::Mutants::Evolutions::TimeTest> ending_test{time};
+  ending_test.set_step_callback(*this, step_callback.get());
 
-  sim_ptr->run(ending_test, bar);
+  profiled_run(ending_test, bar);
 }
 
 void Simulation::run_up_to_size(const std::string& species_name, const size_t& num_of_cells)
 {
   Races::UI::ProgressBar bar;
 
-  validate_non_empty_tissue(sim_ptr->tissue());
+  validate_non_empty_tissue(simulation().tissue());
 
-  const auto& species_id = sim_ptr->tissue().get_species(species_name).get_id();
+  const auto& species_id = simulation().tissue().get_species(species_name).get_id();
 
   RTest<Races::Mutants::Evolutions::SpeciesCountTest> ending_test{species_id, num_of_cells};
+  ending_test.set_step_callback(*this, step_callback.get());
 
-  sim_ptr->run(ending_test, bar);
+  profiled_run(ending_test, bar);
 }
 
 void Simulation::run_up_to_event(const std::string& event, const std::string& species_name,
@@ -888,7 +1155,7 @@ void Simulation::run_up_to_event(const std::string& event, const std::string& sp
 {
   Races::UI::ProgressBar bar;
 
-  validate_non_empty_tissue(sim_ptr->tissue());
+  validate_non_empty_tissue(simulation().tissue());
 
   if (event_names.count(event)==0) {
     handle_unknown_event(event);
@@ -896,18 +1163,242 @@ void Simulation::run_up_to_event(const std::string& event, const std::string& sp
 
   namespace RS = Races::Mutants::Evolutions;
 
-  const auto& species_id = sim_ptr->tissue().get_species(species_name).get_id();
+  const auto& species_id = simulation().tissue().get_species(species_name).get_id();
 
   RTest<RS::EventCountTest> ending_test{event_names.at(event), species_id, num_of_events};
+  ending_test.set_step_callback(*this, step_callback.get());
+
+  profiled_run(ending_test, bar);
+}
+
+const std::set<std::string> ensemble_outputs{"counts", "count_history", "firing_history",
+                                              "samples_forest", "simulation"};
+
+void validate_ensemble_outputs(const std::vector<std::string>& outputs)
+{
+  for (const auto& output : outputs) {
+    if (ensemble_outputs.count(output)==0) {
+      std::ostringstream oss;
+
+      oss << "Unsupported ensemble output \"" << output << "\". Supported outputs are: ";
+      std::string sep;
+      for (const auto& supported : ensemble_outputs) {
+        oss << sep << "\"" << supported << "\"";
+        sep = ", ";
+      }
+      oss << ".";
+
+      throw std::domain_error(oss.str());
+    }
+  }
+}
+
+Rcpp::List Simulation::run_ensemble(const Rcpp::Function& setup, const std::vector<int>& seeds,
+                                    const Races::Time& time, const std::vector<std::string>& outputs,
+                                    const int& num_threads, const SEXP& finalize)
+{
+  using namespace Rcpp;
+
+  const auto threads = validate_num_threads(num_threads);
+  validate_ensemble_outputs(outputs);
+
+  if (!Rf_isNull(finalize) && TYPEOF(finalize) != CLOSXP) {
+    throw std::domain_error("The parameter \"finalize\" must be either NULL "
+                            "or a function.");
+  }
+
+  // replicates are configured by the R setup function in the main thread
+  std::vector<Simulation> replicates;
+  replicates.reserve(seeds.size());
+  for (const auto& seed : seeds) {
+    replicates.emplace_back(get_default_name(), seed, false);
+
+    auto& replicate = replicates.back();
+    setup(wrap(replicate));
+
+    validate_non_empty_tissue(replicate.sim_ptr->tissue());
+  }
+
+  // the replicates are independent: they can evolve in parallel provided
+  // that neither the ending test nor the step callback call the R API
+  run_in_parallel(replicates.size(), threads, [&replicates, &time](const size_t i) {
+    Races::UI::ProgressBar bar;
+
+    Races::Mutants::Evolutions::TimeTest ending_test{time};
+
+    replicates[i].sim_ptr->run(ending_test, bar);
+  });
+
+  List results(replicates.size());
+  for (size_t i=0; i<replicates.size(); ++i) {
+    auto& replicate = replicates[i];
+
+    if (!Rf_isNull(finalize)) {
+      Function(finalize)(wrap(replicate));
+    }
+
+    List result = List::create(_["seed"]=seeds[i]);
+    for (const auto& output : outputs) {
+      if (output == "counts") {
+        result.push_back(replicate.get_counts(), output);
+      } else if (output == "count_history") {
+        result.push_back(replicate.get_count_history(), output);
+      } else if (output == "firing_history") {
+        result.push_back(replicate.get_firing_history(), output);
+      } else if (output == "samples_forest") {
+        if (replicate.sim_ptr->get_tissue_samples().size()>0) {
+          result.push_back(wrap(replicate.get_samples_forest()), output);
+        } else {
+          result.push_back(R_NilValue, output);
+        }
+      } else {
+        result.push_back(wrap(replicate), output);
+      }
+    }
+
+    results[i] = result;
+  }
+
+  return results;
+}
+
+AsyncRun::~AsyncRun()
+{
+  stop_requested = true;
+
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+template<typename SIMULATION_TEST, typename ...Args>
+void Simulation::run_in_background(Args...args)
+{
+  // the step callback calls the R API, which is not thread-safe
+  if (step_callback) {
+    throw std::domain_error("Background runs do not support step callbacks: "
+                            "remove it by using \"clear_step_callback()\".");
+  }
+
+  // a terminated background run must be joined before a new one starts
+  // and its exception, if any, must be raised rather than dropped
+  wait();
+  async_run.reset();
+
+  async_run = std::make_shared<AsyncRun>();
+  async_run->clock = sim_ptr->get_time();
+  async_run->running = true;
+
+  AsyncTest<SIMULATION_TEST> ending_test(*async_run, args...);
+
+  // the worker thread must not call the R API
+  auto* simulation = sim_ptr.get();
+  auto* run = async_run.get();
+  run->worker = std::thread([simulation, run, ending_test]() mutable {
+    try {
+      Races::UI::ProgressBar bar;
+
+      simulation->run(ending_test, bar);
+    } catch (...) {
+      run->exception = std::current_exception();
+    }
+
+    run->clock = simulation->get_time();
+    run->running = false;
+  });
+}
+
+void Simulation::run_up_to_time_async(const Races::Time& time)
+{
+  validate_non_empty_tissue(simulation().tissue());
+
+  run_in_background<Races::Mutants::Evolutions::TimeTest>(time);
+}
+
+void Simulation::run_up_to_size_async(const std::string& species_name, const size_t& num_of_cells)
+{
+  validate_non_empty_tissue(simulation().tissue());
+
+  const auto species_id = simulation().tissue().get_species(species_name).get_id();
+
+  run_in_background<Races::Mutants::Evolutions::SpeciesCountTest>(species_id, num_of_cells);
+}
+
+Rcpp::List Simulation::get_run_status() const
+{
+  using namespace Rcpp;
+
+  if (!async_run) {
+    return List::create(_["running"]=false, _["clock"]=get_clock());
+  }
+
+  return List::create(_["running"]=async_run->running.load(),
+                      _["clock"]=async_run->clock.load());
+}
+
+void Simulation::wait()
+{
+  if (!async_run) {
+    return;
+  }
+
+  while (async_run->running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Rcpp::checkUserInterrupt();
+  }
+
+  if (async_run->worker.joinable()) {
+    async_run->worker.join();
+  }
+
+  auto exception = async_run->exception;
+  async_run->exception = nullptr;
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void Simulation::stop()
+{
+  if (!async_run) {
+    return;
+  }
+
+  async_run->stop_requested = true;
 
-  sim_ptr->run(ending_test, bar);
+  wait();
 }
 
+StepCallback::StepCallback(const Rcpp::Function& function, const size_t& num_of_events,
+                           const Races::Time& time_delta):
+  function(function), num_of_events(num_of_events), time_delta(time_delta)
+{}
+
+void Simulation::set_step_callback(const Rcpp::Function& callback, const size_t& num_of_events,
+                                   const Races::Time& time_delta)
+{
+  if (num_of_events == 0 && time_delta <= 0) {
+    throw std::domain_error("Either the number of events or the time delta "
+                            "must be positive.");
+  }
+
+  step_callback = std::make_shared<StepCallback>(callback, num_of_events, time_delta);
+}
+
+bool Simulation::call_step_callback() const
+{
+  auto result = step_callback->function(get_counts());
+
+  return (TYPEOF(result) == LGLSXP && Rf_length(result) == 1 
+            && LOGICAL(result)[0] == TRUE);
+}
 Rcpp::List Simulation::get_firings() const
 {
   using namespace Rcpp;
 
-  const auto last_time_sample = sim_ptr->get_statistics().get_last_time_in_history();
+  const auto last_time_sample = simulation().get_statistics().get_last_time_in_history();
 
   auto df = get_firing_history(last_time_sample, last_time_sample);
 
@@ -917,11 +1408,11 @@ Rcpp::List Simulation::get_firings() const
 
 Rcpp::List Simulation::get_firing_history(const Races::Time& minimum_time) const
 {
-  if (sim_ptr->get_statistics().get_history().size()==0) {
+  if (simulation().get_statistics().get_history().size()==0) {
     return get_firing_history(0,0);
   }
 
-  const auto last_time_sample = sim_ptr->get_statistics().get_last_time_in_history();
+  const auto last_time_sample = simulation().get_statistics().get_last_time_in_history();
 
   return get_firing_history(minimum_time, last_time_sample);
 }
@@ -930,7 +1421,7 @@ size_t Simulation::count_history_sample_in(const Races::Time& minimum_time,
                                            const Races::Time& maximum_time) const
 {
   size_t num_of_samples{0};
-  const auto& history = sim_ptr->get_statistics().get_history();
+  const auto& history = simulation().get_statistics().get_history();
   auto series_it = history.lower_bound(minimum_time);
   while (series_it != history.end()
          && series_it->first <= maximum_time) {
@@ -946,7 +1437,7 @@ Rcpp::List Simulation::get_firing_history(const Races::Time& minimum_time,
 {
   using namespace Rcpp;
 
-  const size_t rows_per_sample = event_names.size()*sim_ptr->tissue().num_of_species();
+  const size_t rows_per_sample = event_names.size()*simulation().tissue().num_of_species();
   const size_t num_of_rows = count_history_sample_in(minimum_time, maximum_time)*rows_per_sample;
 
   CharacterVector events(num_of_rows), mutant_names(num_of_rows),
@@ -955,12 +1446,12 @@ Rcpp::List Simulation::get_firing_history(const Races::Time& minimum_time,
   NumericVector times(num_of_rows);
 
   size_t i{0};
-  const auto& history = sim_ptr->get_statistics().get_history();
+  const auto& history = simulation().get_statistics().get_history();
   auto series_it = history.lower_bound(minimum_time);
   while (series_it != history.end() && series_it->first <= maximum_time) {
     const auto& time = series_it->first;
     const auto& t_stats = series_it->second;
-    for (const auto& species: sim_ptr->tissue()) {
+    for (const auto& species: simulation().tissue()) {
       for (const auto& [event_name, event_code]: event_names) {
         events[i] = event_name;
         mutant_names[i] = species.get_mutant_name();
@@ -986,11 +1477,11 @@ Rcpp::List Simulation::get_firing_history(const Races::Time& minimum_time,
 
 Rcpp::List Simulation::get_count_history(const Races::Time& minimum_time) const
 {
-  if (sim_ptr->get_statistics().get_history().size()==0) {
+  if (simulation().get_statistics().get_history().size()==0) {
     return get_count_history(0,0);
   }
 
-  const auto last_time_sample = sim_ptr->get_statistics().get_last_time_in_history();
+  const auto last_time_sample = simulation().get_statistics().get_last_time_in_history();
 
   return get_count_history(minimum_time, last_time_sample);
 }
@@ -1000,7 +1491,7 @@ Rcpp::List Simulation::get_count_history(const Races::Time& minimum_time,
 {
   using namespace Rcpp;
 
-  const size_t rows_per_sample = sim_ptr->tissue().num_of_species();
+  const size_t rows_per_sample = simulation().tissue().num_of_species();
   const size_t num_of_rows = count_history_sample_in(minimum_time, maximum_time)*rows_per_sample;
 
   CharacterVector mutant_names(num_of_rows), epi_states(num_of_rows);
@@ -1008,12 +1499,12 @@ Rcpp::List Simulation::get_count_history(const Races::Time& minimum_time,
   NumericVector times(num_of_rows);
 
   size_t i{0};
-  const auto& history = sim_ptr->get_statistics().get_history();
+  const auto& history = simulation().get_statistics().get_history();
   auto series_it = history.lower_bound(minimum_time);
   while (series_it != history.end() && series_it->first <= maximum_time) {
     const auto& time = series_it->first;
     const auto& t_stats = series_it->second;
-    for (const auto& species: sim_ptr->tissue()) {
+    for (const auto& species: simulation().tissue()) {
       mutant_names[i] = species.get_mutant_name();
       epi_states[i] = get_signature_string(species);
 
@@ -1033,9 +1524,89 @@ Rcpp::List Simulation::get_count_history(const Races::Time& minimum_time,
                            _["count"]=counts, _["time"]=times);
 }
 
+Rcpp::List Simulation::get_new_count_history()
+{
+  using namespace Rcpp;
+
+  const SpeciesFactorCodes species_codes(simulation().tissue());
+
+  std::vector<int> mutants, epi_states, counts;
+  std::vector<double> times;
+
+  // only the non-null counts sampled after the cursor are reported
+  const auto& history = simulation().get_statistics().get_history();
+  for (auto series_it = history.upper_bound(count_history_cursor);
+        series_it != history.end(); ++series_it) {
+    const auto& [time, t_stats] = *series_it;
+    for (const auto& [species_id, species_stats]: t_stats) {
+      if (species_stats.curr_cells>0) {
+        mutants.push_back(species_codes.mutant_codes[species_id]);
+        epi_states.push_back(species_codes.epistate_codes[species_id]);
+        counts.push_back(species_stats.curr_cells);
+        times.push_back(time);
+      }
+    }
+
+    count_history_cursor = time;
+  }
+
+  return DataFrame::create(_["mutant"]=as_factor(mutants, species_codes.mutant_levels),
+                           _["epistate"]=as_factor(epi_states, species_codes.epistate_levels),
+                           _["count"]=counts, _["time"]=times);
+}
+
+Rcpp::List Simulation::get_new_firing_history()
+{
+  using namespace Rcpp;
+
+  const SpeciesFactorCodes species_codes(simulation().tissue());
+
+  std::vector<std::string> event_levels;
+  for (const auto& [event_name, event_code]: event_names) {
+    event_levels.push_back(event_name);
+  }
+
+  std::vector<int> events, mutants, epi_states, firings;
+  std::vector<double> times;
+
+  // only the non-null firings sampled after the cursor are reported
+  const auto& history = simulation().get_statistics().get_history();
+  for (auto series_it = history.upper_bound(firing_history_cursor);
+        series_it != history.end(); ++series_it) {
+    const auto& [time, t_stats] = *series_it;
+    for (const auto& [species_id, species_stats]: t_stats) {
+      int event_index{1};
+      for (const auto& [event_name, event_code]: event_names) {
+        const auto fired = count_events(species_stats, event_code);
+        if (fired>0) {
+          events.push_back(event_index);
+          mutants.push_back(species_codes.mutant_codes[species_id]);
+          epi_states.push_back(species_codes.epistate_codes[species_id]);
+          firings.push_back(fired);
+          times.push_back(time);
+        }
+        ++event_index;
+      }
+    }
+
+    firing_history_cursor = time;
+  }
+
+  return DataFrame::create(_["event"]=as_factor(events, event_levels),
+                           _["mutant"]=as_factor(mutants, species_codes.mutant_levels),
+                           _["epistate"]=as_factor(epi_states, species_codes.epistate_levels),
+                           _["fired"]=firings, _["time"]=times);
+}
+
+void Simulation::reset_history_cursors()
+{
+  count_history_cursor = -std::numeric_limits<Races::Time>::infinity();
+  firing_history_cursor = -std::numeric_limits<Races::Time>::infinity();
+}
+
 Rcpp::IntegerVector Simulation::get_tissue_size() const
 {
-  auto size_vect = sim_ptr->tissue().size();
+  auto size_vect = simulation().tissue().size();
 
   return {size_vect[0], size_vect[1]};
 }
@@ -1044,7 +1615,7 @@ Rcpp::List Simulation::get_rates(const std::string& species_name) const
 {
   using namespace Rcpp;
 
-  auto& species = sim_ptr->tissue().get_species(species_name);
+  auto& species = simulation().tissue().get_species(species_name);
 
   auto rates = List::create(_("growth") = species.get_rate(event_names.at("growth")),
                             _["death"] = species.get_rate(event_names.at("death")));
@@ -1061,7 +1632,7 @@ void Simulation::update_rates(const std::string& species_name, const Rcpp::List&
   using namespace Rcpp;
   using namespace Races::Mutants;
 
-  auto& species = sim_ptr->tissue().get_species(species_name);
+  auto& species = simulation().tissue().get_species(species_name);
 
   if (!rates.hasAttribute("names")) {
     throw std::domain_error("update_rates: The second parameter must be a Rcpp::List "
@@ -1086,10 +1657,10 @@ Simulation::choose_cell_in(const std::string& mutant_name,
 {
   namespace RS = Races::Mutants::Evolutions;
 
-  if (sim_ptr->duplicate_internal_cells) {
+  if (simulation().duplicate_internal_cells) {
     const auto rectangle = get_rectangle(lower_corner, upper_corner);
-    const auto& cell = sim_ptr->choose_cell_in(mutant_name, rectangle,
-                                               Races::Mutants::CellEventType::DUPLICATION);
+    const auto& cell = simulation().choose_cell_in(mutant_name, rectangle,
+                                                   Races::Mutants::CellEventType::DUPLICATION);
 
     return wrap_a_cell(cell);
   }
@@ -1101,9 +1672,9 @@ Rcpp::List Simulation::choose_cell_in(const std::string& mutant_name)
 {
   namespace RS = Races::Mutants::Evolutions;
 
-  if (sim_ptr->duplicate_internal_cells) {
-    const auto& cell = sim_ptr->choose_cell_in(mutant_name,
-                                                Races::Mutants::CellEventType::DUPLICATION);
+  if (simulation().duplicate_internal_cells) {
+    const auto& cell = simulation().choose_cell_in(mutant_name,
+                                                   Races::Mutants::CellEventType::DUPLICATION);
     return wrap_a_cell(cell);
   }
 
@@ -1112,7 +1683,7 @@ Rcpp::List Simulation::choose_cell_in(const std::string& mutant_name)
 
 Rcpp::List Simulation::choose_border_cell_in(const std::string& mutant_name)
 {
-    const auto& cell = sim_ptr->choose_border_cell_in(mutant_name);
+    const auto& cell = simulation().choose_border_cell_in(mutant_name);
 
     return wrap_a_cell(cell);
 }
@@ -1122,7 +1693,7 @@ Rcpp::List Simulation::choose_border_cell_in(const std::string& mutant_name,
                                              const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner)
 {
     const auto rectangle = get_rectangle(lower_corner, upper_corner);
-    const auto& cell = sim_ptr->choose_border_cell_in(mutant_name, rectangle);
+    const auto& cell = simulation().choose_border_cell_in(mutant_name, rectangle);
 
     return wrap_a_cell(cell);
 }
@@ -1135,7 +1706,7 @@ void Simulation::mutate_progeny(const Races::Mutants::Evolutions::AxisPosition&
 
   namespace RS = Races::Mutants::Evolutions;
 
-  sim_ptr->simulate_mutation(pos_in_tissue, mutated_mutant);
+  simulation().simulate_mutation(pos_in_tissue, mutated_mutant);
 }
 
 
@@ -1169,7 +1740,7 @@ void Simulation::sample_cells(const std::string& sample_name,
 
   auto rectangle = get_rectangle(lower_corner, upper_corner);
 
-  sim_ptr->sample_tissue(sample_name, rectangle);
+  simulation().sample_tissue(sample_name, rectangle);
 }
 
 template<typename SAMPLES>
@@ -1207,52 +1778,42 @@ Rcpp::List get_samples_info(const SAMPLES& samples)
 
 Rcpp::List Simulation::get_samples_info() const
 {
-  return ::get_samples_info(sim_ptr->get_tissue_samples());
+  return ::get_samples_info(simulation().get_tissue_samples());
 }
 
 SamplesForest Simulation::get_samples_forest() const
 {
-  return SamplesForest(*sim_ptr);
-}
+  // the samples forest exclusively depends on the tissue samples: the
+  // simulation log is read again only when new samples have been collected
+  const auto num_of_samples = simulation().get_tissue_samples().size();
 
-size_t count_in(const std::set<Races::Mutants::SpeciesId>& species_ids,
-                const Races::Mutants::Evolutions::Tissue& tissue,
-                const uint16_t& init_x, const uint16_t& init_y,
-                const uint16_t& width, const uint16_t& height)
-{
-  size_t counter{0};
-  auto sizes = tissue.size();
+  if (!samples_forest_cache || samples_forest_cache->num_of_samples != num_of_samples) {
+    Profiler::ScopedTimer timer(profiler.get(), "samples forest construction");
 
-  uint16_t x_max = std::min(static_cast<uint16_t>(init_x+width), sizes[0]);
-  uint16_t y_max = std::min(static_cast<uint16_t>(init_y+height), sizes[1]);
+    samples_forest_cache = std::make_shared<const SamplesForestCache>(
+                              SamplesForestCache{num_of_samples, SamplesForest(simulation())});
+  }
 
-  for (uint16_t x=init_x; x<x_max; ++x) {
-    for (uint16_t y=init_y; y<y_max; ++y) {
-      auto cell_proxy = tissue({x,y});
-      if (!cell_proxy.is_wild_type()) {
-        const Races::Mutants::Evolutions::CellInTissue& cell = cell_proxy;
+  return samples_forest_cache->forest;
+}
 
-        if (species_ids.count(cell.get_species_id())>0) {
-          ++counter;
-        }
-      }
-    }
-  }
+SamplesForest Simulation::get_samples_forest(const std::vector<std::string>& sample_names) const
+{
+  get_samples_forest();
 
-  return counter;
+  return samples_forest_cache->forest.get_subforest_for(sample_names);
 }
 
 inline
-size_t count_in(const std::set<Races::Mutants::SpeciesId>& species_ids,
-                const Races::Mutants::Evolutions::Tissue& tissue,
+size_t count_in(const SummedAreaTable& table,
                 const TissueRectangle& tumor_bounding_box,
                 const uint16_t& grid_x, const uint16_t& grid_y,
                 const uint16_t& width, const uint16_t& height)
 {
-  const uint16_t x = grid_x*width+tumor_bounding_box.lower_corner.x,
-                 y = grid_y*height+tumor_bounding_box.lower_corner.y;
+  const size_t x = grid_x*width+tumor_bounding_box.lower_corner.x,
+               y = grid_y*height+tumor_bounding_box.lower_corner.y;
 
-  return count_in(species_ids, tissue, x, y, width, height);
+  return table.count_in(x, y, width, height);
 }
 
 inline 
@@ -1288,32 +1849,7 @@ collect_species_of(const Races::Mutants::Evolutions::Simulation& simulation,
 
 TissueRectangle Simulation::get_tumor_bounding_box() const
 {
-  using namespace Races::Mutants::Evolutions;
-  const auto& tissue = sim_ptr->tissue();
-  const auto tissue_sizes = tissue.size();
-
-  PositionInTissue lower_corner(static_cast<AxisSize>(tissue_sizes[0]),
-                                static_cast<AxisSize>(tissue_sizes[1])), upper_corner{0,0};
-
-  for (uint16_t grid_x=0; grid_x<tissue_sizes[0]; ++grid_x) {
-    for (uint16_t grid_y=0; grid_y<tissue_sizes[1]; ++grid_y) {
-      Races::Mutants::Evolutions::PositionInTissue pos{grid_x, grid_y};
-      if (!tissue(pos).is_wild_type()) {
-        if (grid_x < lower_corner.x) {
-          lower_corner.x = grid_x;
-        }
-        if (grid_y < lower_corner.y) {
-          lower_corner.y = grid_y;
-        }
-        if (grid_x > upper_corner.x) {
-          upper_corner.x = grid_x;
-        }
-        if (grid_y > upper_corner.y) {
-          upper_corner.y = grid_y;
-        }
-      }
-    }
-  }
+  const auto [lower_corner, upper_corner] = get_tumor_corners(simulation().tissue());
 
   return {lower_corner, upper_corner};
 }
@@ -1329,11 +1865,18 @@ inline T div_ceil(const T& dividend, const T& divisor)
 TissueRectangle Simulation::search_sample(const std::string& mutant_name, const size_t& num_of_cells,
                                           const uint16_t& width, const uint16_t& height)
 {
-  auto species_ids = collect_species_of(*sim_ptr, mutant_name);
+  auto species_ids = collect_species_of(simulation(), mutant_name);
+
+  // one visit of the tumour cells provides both the tumour bounding
+  // box and constant time counts for all the grid rectangles
+  SummedAreaTable table(simulation().tissue(), species_ids);
+
+  if (!table.has_tumor()) {
+    throw std::runtime_error("No bounding box found!");
+  }
 
-  auto t_bbox = get_tumor_bounding_box();
+  auto t_bbox = table.get_tumor_bounding_box();
 
-  const auto& tissue = sim_ptr->tissue();
   const auto t_width = t_bbox.upper_corner.x - t_bbox.lower_corner.x;
   const auto t_height = t_bbox.upper_corner.y - t_bbox.lower_corner.y;
 
@@ -1347,7 +1890,7 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
     uint16_t grid_x=diag, grid_y=diag;
 
     for (; grid_x<grid_width-diag; ++grid_x) {
-      const auto counted_cells = count_in(species_ids, tissue, t_bbox, grid_x, grid_y, 
+      const auto counted_cells = count_in(table, t_bbox, grid_x, grid_y, 
                                           width, height);
       if (counted_cells>num_of_cells) {
         return get_tissue_rectangle(t_bbox, grid_x, grid_y, width, height);
@@ -1355,7 +1898,7 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
     }
 
     for (; grid_y<grid_height-diag; ++grid_y) {
-      const auto counted_cells = count_in(species_ids, tissue, t_bbox, grid_x, grid_y, 
+      const auto counted_cells = count_in(table, t_bbox, grid_x, grid_y, 
                                           width, height);
       if (counted_cells>num_of_cells) {
         return get_tissue_rectangle(t_bbox, grid_x, grid_y, width, height);
@@ -1363,7 +1906,7 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
     }
 
     for (; grid_x>diag; --grid_x) {
-      const auto counted_cells = count_in(species_ids, tissue, t_bbox, grid_x, grid_y, 
+      const auto counted_cells = count_in(table, t_bbox, grid_x, grid_y, 
                                           width, height);
       if (counted_cells>num_of_cells) {
         return get_tissue_rectangle(t_bbox, grid_x, grid_y, width, height);
@@ -1371,7 +1914,7 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
     }
 
     {
-      const auto counted_cells = count_in(species_ids, tissue, t_bbox, grid_x, grid_y, 
+      const auto counted_cells = count_in(table, t_bbox, grid_x, grid_y, 
                                           width, height);
       if (counted_cells>num_of_cells) {
         return get_tissue_rectangle(t_bbox, grid_x, grid_y, width, height);
@@ -1379,7 +1922,7 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
     }
 
     for (; grid_y>diag; --grid_y) {
-      const auto counted_cells = count_in(species_ids, tissue, t_bbox, grid_x, grid_y, 
+      const auto counted_cells = count_in(table, t_bbox, grid_x, grid_y, 
                                           width, height);
       if (counted_cells>num_of_cells) {
         return get_tissue_rectangle(t_bbox, grid_x, grid_y, width, height);
@@ -1389,3 +1932,52 @@ TissueRectangle Simulation::search_sample(const std::string& mutant_name, const
   throw std::runtime_error("No bounding box found!");
 }
 
+
+TissueRectangle Simulation::search_densest_sample(const std::string& mutant_name,
+                                                  const uint16_t& width, const uint16_t& height)
+{
+  using namespace Races::Mutants::Evolutions;
+
+  auto species_ids = collect_species_of(simulation(), mutant_name);
+
+  SummedAreaTable table(simulation().tissue(), species_ids);
+
+  if (!table.has_tumor()) {
+    throw std::runtime_error("No bounding box found!");
+  }
+
+  const auto t_bbox = table.get_tumor_bounding_box();
+
+  // every rectangle overlapping the tumour bounding box and laying in
+  // the tissue is tested
+  const auto tissue_sizes = simulation().tissue().size();
+  const size_t x_size = tissue_sizes[0], y_size = tissue_sizes[1];
+  const size_t x_max = std::min(static_cast<size_t>(t_bbox.upper_corner.x),
+                                (x_size>width? x_size-width: 0));
+  const size_t y_max = std::min(static_cast<size_t>(t_bbox.upper_corner.y),
+                                (y_size>height? y_size-height: 0));
+  const size_t x_begin = std::min(x_max, static_cast<size_t>(t_bbox.lower_corner.x+1>width?
+                                                             t_bbox.lower_corner.x+1-width: 0));
+  const size_t y_begin = std::min(y_max, static_cast<size_t>(t_bbox.lower_corner.y+1>height?
+                                                             t_bbox.lower_corner.y+1-height: 0));
+
+  size_t best_count{0};
+  PositionInTissue best_corner{static_cast<AxisPosition>(x_begin),
+                               static_cast<AxisPosition>(y_begin)};
+  for (size_t x=x_begin; x<=x_max; ++x) {
+    for (size_t y=y_begin; y<=y_max; ++y) {
+      const auto counted_cells = table.count_in(x, y, width, height);
+      if (counted_cells>best_count) {
+        best_count = counted_cells;
+        best_corner = PositionInTissue{static_cast<AxisPosition>(x),
+                                       static_cast<AxisPosition>(y)};
+      }
+    }
+  }
+
+  if (best_count==0) {
+    throw std::runtime_error("No cell of mutant \""+mutant_name+"\" in the tissue.");
+  }
+
+  return TissueRectangle(best_corner, width, height);
+}
@@ -21,6 +21,12 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <exception>
+#include <filesystem>
 
 #include <Rcpp.h>
 
@@ -28,6 +34,7 @@
 
 #include "tissue_rectangle.hpp"
 #include "samples_forest.hpp"
+#include "profiler.hpp"
 
 
 struct PlainChooser
@@ -62,14 +69,68 @@ struct RectangularChooser : public PlainChooser
 };
 
 
+/**
+ * @brief An R function periodically called during the simulations
+ */
+struct StepCallback
+{
+  Rcpp::Function function;  //!< the R function
+  size_t num_of_events;     //!< the number of events between two calls (0 to disable)
+  Races::Time time_delta;   //!< the simulated time between two calls (0 to disable)
+
+  StepCallback(const Rcpp::Function& function, const size_t& num_of_events,
+               const Races::Time& time_delta);
+};
+
+/**
+ * @brief The state of a simulation running in a background thread
+ */
+struct AsyncRun
+{
+  std::thread worker;                     //!< the thread running the simulation
+  std::atomic<bool> running{false};       //!< a flag for running simulations
+  std::atomic<bool> stop_requested{false};//!< a flag to request the simulation stop
+  std::atomic<Races::Time> clock{0};      //!< the last observed simulated time
+  std::exception_ptr exception;           //!< the exception raised by the simulation
+
+  ~AsyncRun();
+};
+
+/**
+ * @brief A samples forest built from the simulation log
+ */
+struct SamplesForestCache
+{
+  size_t num_of_samples;  //!< the number of tissue samples when the forest was built
+  SamplesForest forest;   //!< the samples forest
+};
+
 class Simulation
 {
   std::shared_ptr<Races::Mutants::Evolutions::Simulation> sim_ptr;  //!< The pointer to a RACES simulation object
   std::string name;      //!< The simulation name
   bool save_snapshots;   //!< A flag to preserve binary dump after object destruction
 
+  //! The temporary log directory created by this object (if any)
+  std::filesystem::path tmp_directory;
+
+  std::shared_ptr<StepCallback> step_callback;  //!< The step callback (if any)
+  std::shared_ptr<AsyncRun> async_run;          //!< The background run (if any)
+  std::shared_ptr<Profiler> profiler;           //!< The profiler (null when disabled)
+
+  //! The time of the last history sample returned by `get_new_count_history()`
+  Races::Time count_history_cursor{-std::numeric_limits<Races::Time>::infinity()};
+
+  //! The time of the last history sample returned by `get_new_firing_history()`
+  Races::Time firing_history_cursor{-std::numeric_limits<Races::Time>::infinity()};
+
+  //! The last samples forest built from the simulation log (if any)
+  mutable std::shared_ptr<const SamplesForestCache> samples_forest_cache;
+
   void init(const SEXP& sexp);
 
+  std::filesystem::path new_tmp_directory();
+
   static bool has_names(const Rcpp::List& list, std::vector<std::string> aimed_names);
 
   static bool has_names_in(const Rcpp::List& list, std::set<std::string> aimed_names);
@@ -79,10 +140,30 @@ class Simulation
   Rcpp::List get_cells(const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
                  const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
                  const std::set<Races::Mutants::SpeciesId> &species_filter,
-                 const std::set<std::string> &epigenetic_filter) const;
+                 const std::set<std::string> &epigenetic_filter,
+                 const size_t& stride, const bool& as_factors) const;
 
   Rcpp::List wrap_a_cell(const Races::Mutants::Evolutions::CellInTissue& cell) const;
 
+  void validate_not_running() const;
+
+  /**
+   * @brief Get the RACES simulation
+   *
+   * Except for the background runs, all the methods access the RACES
+   * simulation by using this method, which refuses the access while
+   * a background run is evolving the simulation.
+   *
+   * @return a reference to the RACES simulation
+   */
+  Races::Mutants::Evolutions::Simulation& simulation() const;
+
+  template<typename SIMULATION_TEST>
+  void profiled_run(SIMULATION_TEST& ending_test, Races::UI::ProgressBar& bar);
+
+  template<typename SIMULATION_TEST, typename ...Args>
+  void run_in_background(Args...args);
+
 public:
   Simulation();
 
@@ -98,13 +179,13 @@ public:
                             const Races::Mutants::Evolutions::AxisSize& width,
                             const Races::Mutants::Evolutions::AxisSize& height)
   {
-    sim_ptr->set_tissue(name, {width, height});
+    simulation().set_tissue(name, {width, height});
   }
 
   inline void update_tissue(const Races::Mutants::Evolutions::AxisSize& width,
                             const Races::Mutants::Evolutions::AxisSize& height)
   {
-    sim_ptr->set_tissue("A tissue", {width, height});
+    simulation().set_tissue("A tissue", {width, height});
   }
 
   void add_mutant(const std::string& mutant, const Rcpp::List& epigenetic_rates,
@@ -116,7 +197,7 @@ public:
 
   inline Races::Time get_clock() const
   {
-    return sim_ptr->get_time();
+    return simulation().get_time();
   }
 
   void place_cell(const std::string& species_name,
@@ -158,6 +239,12 @@ public:
                  const std::vector<std::string>& mutant_filter,
                  const std::vector<std::string>& epigenetic_filter) const;
 
+  Rcpp::List get_cells(const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
+                 const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner,
+                 const std::vector<std::string>& mutant_filter,
+                 const std::vector<std::string>& epigenetic_filter,
+                 const size_t& stride, const bool& as_factors) const;
+
   Rcpp::List get_lineage_graph() const;
 
   Rcpp::List get_samples_info() const;
@@ -165,7 +252,7 @@ public:
   inline void schedule_mutation(const std::string& src, const std::string& dst,
                                          const Races::Time& time)
   {
-    sim_ptr->schedule_mutation(src, dst, time);
+    simulation().schedule_mutation(src, dst, time);
   }
 
   void run_up_to_time(const Races::Time& time);
@@ -175,6 +262,32 @@ public:
   void run_up_to_event(const std::string& event, const std::string& species_name,
                        const size_t& num_of_events);
 
+  void run_up_to_time_async(const Races::Time& time);
+
+  void run_up_to_size_async(const std::string& species_name, const size_t& num_of_cells);
+
+  Rcpp::List get_run_status() const;
+
+  void wait();
+
+  void stop();
+
+  void set_step_callback(const Rcpp::Function& callback, const size_t& num_of_events,
+                         const Races::Time& time_delta);
+
+  inline void clear_step_callback()
+  {
+    step_callback.reset();
+  }
+
+  /**
+   * @brief Call the step callback
+   *
+   * @return `true` if and only if the callback requires to stop the
+   *      simulation
+   */
+  bool call_step_callback() const;
+
   void sample_cells(const std::string& sample_name,
                     const std::vector<Races::Mutants::Evolutions::AxisPosition>& lower_corner,
                     const std::vector<Races::Mutants::Evolutions::AxisPosition>& upper_corner) const;
@@ -188,6 +301,12 @@ public:
 
   Rcpp::List get_firing_history(const Races::Time& minimum_time) const;
 
+  Rcpp::List get_new_count_history();
+
+  Rcpp::List get_new_firing_history();
+
+  void reset_history_cursors();
+
   Rcpp::List get_firing_history(const Races::Time& minimum_time,
                           const Races::Time& maximum_time) const;
 
@@ -200,11 +319,13 @@ public:
 
   inline const std::string& get_tissue_name() const
   {
-    return sim_ptr->tissue().get_name();
+    return simulation().tissue().get_name();
   }
 
   Rcpp::IntegerVector get_tissue_size() const;
 
+  double get_disk_usage() const;
+
   Rcpp::List get_rates(const std::string& species_name) const;
 
   void update_rates(const std::string& species_name, const Rcpp::List& list);
@@ -216,7 +337,7 @@ public:
 
     const auto directions = get_possible_directions();
 
-    const RS::Tissue& tissue = sim_ptr->tissue();
+    const RS::Tissue& tissue = simulation().tissue();
 
     size_t i{0};
     while (++i<1000) {
@@ -258,42 +379,60 @@ public:
 
   inline size_t get_death_activation_level() const
   {
-    return sim_ptr->death_activation_level;
+    return simulation().death_activation_level;
   }
 
   inline void set_death_activation_level(const size_t death_activation_level)
   {
-    sim_ptr->death_activation_level = death_activation_level;
+    simulation().death_activation_level = death_activation_level;
   }
 
   inline bool get_duplicate_internal_cells() const
   {
-    return sim_ptr->duplicate_internal_cells;
+    return simulation().duplicate_internal_cells;
   }
 
   inline void set_duplicate_internal_cells(const bool duplicate_internal_cells)
   {
-    sim_ptr->duplicate_internal_cells = duplicate_internal_cells;
+    simulation().duplicate_internal_cells = duplicate_internal_cells;
   }
 
   inline Races::Time get_history_delta() const
   {
-    return sim_ptr->get_statistics().get_history_delta();
+    return simulation().get_statistics().get_history_delta();
   }
 
   inline void set_history_delta(const Races::Time history_time_delta)
   {
-    sim_ptr->get_statistics().set_history_delta(history_time_delta);
+    simulation().get_statistics().set_history_delta(history_time_delta);
+  }
+
+  void set_profiling(const bool& enabled);
+
+  inline Rcpp::List get_profile() const
+  {
+    return Profiler::get_dataframe(profiler.get());
   }
 
   static Simulation load(const std::string& directory_name);
 
+  Simulation fork() const;
+
+  static Rcpp::List run_ensemble(const Rcpp::Function& setup, const std::vector<int>& seeds,
+                                 const Races::Time& time, const std::vector<std::string>& outputs,
+                                 const int& num_threads, const SEXP& finalize);
+
   SamplesForest get_samples_forest() const;
 
+  SamplesForest get_samples_forest(const std::vector<std::string>& sample_names) const;
+
   TissueRectangle get_tumor_bounding_box() const;
 
   TissueRectangle search_sample(const std::string& mutant_name, const size_t& num_of_cells,
                                 const uint16_t& width, const uint16_t& height);
+
+  TissueRectangle search_densest_sample(const std::string& mutant_name,
+                                        const uint16_t& width, const uint16_t& height);
 };
 
 RCPP_EXPOSED_CLASS(Simulation)
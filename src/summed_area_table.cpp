@@ -0,0 +1,101 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <tuple>
+
+#include "summed_area_table.hpp"
+
+std::pair<Races::Mutants::Evolutions::PositionInTissue, Races::Mutants::Evolutions::PositionInTissue>
+get_tumor_corners(const Races::Mutants::Evolutions::Tissue& tissue)
+{
+  using namespace Races::Mutants::Evolutions;
+
+  PositionInTissue lower_corner(static_cast<AxisSize>(tissue.size()[0]),
+                                static_cast<AxisSize>(tissue.size()[1])), upper_corner{0,0};
+
+  // the species store their cells: visiting them costs the tumour
+  // size rather than the tissue area
+  for (const auto& species: tissue) {
+    for (const CellInTissue& cell: species) {
+      if (cell.x < lower_corner.x) {
+        lower_corner.x = cell.x;
+      }
+      if (cell.y < lower_corner.y) {
+        lower_corner.y = cell.y;
+      }
+      if (cell.x > upper_corner.x) {
+        upper_corner.x = cell.x;
+      }
+      if (cell.y > upper_corner.y) {
+        upper_corner.y = cell.y;
+      }
+    }
+  }
+
+  return {lower_corner, upper_corner};
+}
+
+SummedAreaTable::SummedAreaTable(const Races::Mutants::Evolutions::Tissue& tissue,
+                                 const std::set<Races::Mutants::SpeciesId>& species_ids):
+  tumor_lower_corner{0,0}, tumor_upper_corner{0,0}, x_size(0), y_size(0)
+{
+  using namespace Races::Mutants::Evolutions;
+
+  std::tie(tumor_lower_corner, tumor_upper_corner) = get_tumor_corners(tissue);
+
+  if (!has_tumor()) {
+    table.resize(1, 0);
+
+    return;
+  }
+
+  x_size = tumor_upper_corner.x-tumor_lower_corner.x+1;
+  y_size = tumor_upper_corner.y-tumor_lower_corner.y+1;
+  table.resize((x_size+1)*(y_size+1), 0);
+
+  for (const auto& species: tissue) {
+    if (species_ids.count(species.get_id())>0) {
+      for (const CellInTissue& cell: species) {
+        ++at(cell.x-tumor_lower_corner.x+1, cell.y-tumor_lower_corner.y+1);
+      }
+    }
+  }
+
+  for (size_t x=1; x<=x_size; ++x) {
+    uint32_t column_sum{0};
+    for (size_t y=1; y<=y_size; ++y) {
+      column_sum += at(x, y);
+      at(x, y) = at(x-1, y) + column_sum;
+    }
+  }
+}
+
+size_t SummedAreaTable::count_in(const size_t& x, const size_t& y,
+                                 const size_t& width, const size_t& height) const
+{
+  auto clip = [](const size_t& value, const size_t& origin, const size_t& size) {
+    return (value<origin? 0: std::min(value-origin, size));
+  };
+
+  const size_t x_min = clip(x, tumor_lower_corner.x, x_size),
+               y_min = clip(y, tumor_lower_corner.y, y_size);
+  const size_t x_max = clip(x+width, tumor_lower_corner.x, x_size),
+               y_max = clip(y+height, tumor_lower_corner.y, y_size);
+
+  return at(x_max, y_max) + at(x_min, y_min) - at(x_min, y_max) - at(x_max, y_min);
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of the rRACES (https://github.com/caravagnalab/rRACES/).
+ * Copyright (c) 2023-2024 Alberto Casagrande <alberto.casagrande@uniud.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RRACES_SUMMED_AREA_TABLE__
+#define __RRACES_SUMMED_AREA_TABLE__
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <tissue.hpp>
+
+#include "tissue_rectangle.hpp"
+
+/**
+ * @brief Compute the corners of the tumour bounding box
+ *
+ * The tumour cells are visited by species, so the cost is the tumour
+ * size rather than the tissue area.
+ *
+ * @param tissue is the tissue
+ * @return the lower and upper corners of the bounding box of the
+ *      non-wild-type cells in `tissue`. When `tissue` contains no such
+ *      cell, the lower corner is greater than the upper one
+ */
+std::pair<Races::Mutants::Evolutions::PositionInTissue, Races::Mutants::Evolutions::PositionInTissue>
+get_tumor_corners(const Races::Mutants::Evolutions::Tissue& tissue);
+
+/**
+ * @brief A summed-area table of the cells of some species in a tissue
+ *
+ * This class counts in constant time the cells of a set of species 
+ * laying in any rectangle of the tissue. It also records the bounding 
+ * box of the tumour, i.e., of the non-wild-type cells. The table is 
+ * built by visiting the tumour cells once and it only covers the 
+ * tumour bounding box, because no cell is counted outside it.
+ */
+class SummedAreaTable
+{
+  /**
+   * @brief The summed-area table
+   *
+   * The element in position `x*(y_size+1)+y` is the number of counted 
+   * cells in `[x_origin,x_origin+x)x[y_origin,y_origin+y)`.
+   */
+  std::vector<uint32_t> table;
+
+  Races::Mutants::Evolutions::PositionInTissue tumor_lower_corner;
+  Races::Mutants::Evolutions::PositionInTissue tumor_upper_corner;
+
+  size_t x_size;    //!< the table size on the x axis
+  size_t y_size;    //!< the table size on the y axis
+
+  inline const uint32_t& at(const size_t& x, const size_t& y) const
+  {
+    return table[x*(y_size+1)+y];
+  }
+
+  inline uint32_t& at(const size_t& x, const size_t& y)
+  {
+    return table[x*(y_size+1)+y];
+  }
+public:
+  /**
+   * @brief Build the summed-area table of some species in a tissue
+   *
+   * @param tissue is the tissue
+   * @param species_ids is the set of the species whose cells are counted
+   */
+  SummedAreaTable(const Races::Mutants::Evolutions::Tissue& tissue,
+                  const std::set<Races::Mutants::SpeciesId>& species_ids);
+
+  /**
+   * @brief Count the cells in a rectangle
+   *
+   * The rectangle is clipped to the tumour bounding box.
+   *
+   * @param x is the lower corner position on the x axis
+   * @param y is the lower corner position on the y axis
+   * @param width is the rectangle width
+   * @param height is the rectangle height
+   * @return the number of counted cells in the rectangle
+   */
+  size_t count_in(const size_t& x, const size_t& y,
+                  const size_t& width, const size_t& height) const;
+
+  /**
+   * @brief Test whether the tissue contains non-wild-type cells
+   *
+   * @return `true` if and only if the tissue contains at least one
+   *      non-wild-type cell
+   */
+  inline bool has_tumor() const
+  {
+    return tumor_lower_corner.x <= tumor_upper_corner.x;
+  }
+
+  /**
+   * @brief Get the tumour bounding box
+   *
+   * @return the bounding box of the non-wild-type cells
+   */
+  inline TissueRectangle get_tumor_bounding_box() const
+  {
+    return {tumor_lower_corner, tumor_upper_corner};
+  }
+};
+
+#endif // __RRACES_SUMMED_AREA_TABLE__